@@ -0,0 +1,161 @@
+/****************************************************************************************************************************
+  ESP32-MultiClientServer.ino
+  For ESP32.
+
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52 and SAMD21/SAMD51 boards besides ESP8266 and ESP32
+
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+ *****************************************************************************************************************************/
+/****************************************************************************************************************************
+  ESP32 Websockets Server : Multi-client ESP32 Websockets Server
+
+  This sketch:
+        1. Connects to a WiFi network
+        2. Starts a websocket server on port 8080
+        3. Keeps up to 4 clients connected at the same time, all served from server.poll()
+        4. Sends an "echo" of every message back to its sender
+        5. Tells every client when someone joins or leaves
+
+  Hardware:
+        For this sketch you only need an ESP32 board.
+
+  Originally Created  : 15/02/2019
+  Original Author     : By Gil Maimon
+  Original Repository : https://github.com/gilmaimon/ArduinoWebsockets
+
+*****************************************************************************************************************************/
+
+#include "defines.h"
+
+#define DEBUG_LOCAL   2
+
+#include <WebSockets2_Generic.h>
+#include <WiFi.h>
+
+using namespace websockets2_generic;
+
+WebsocketsServer server;
+
+void onMessageCallback(WebsocketsClient& client, WebsocketsMessage message)
+{
+  Serial.print("Got Message: ");
+  Serial.println(message.data());
+
+  // return echo
+  client.send("Echo: " + message.data());
+}
+
+void onEventsCallback(WebsocketsClient& client, WebsocketsEvent event, String data)
+{
+  (void) client;
+  (void) data;
+  
+  if (event == WebsocketsEvent::ConnectionClosed)
+  {
+    Serial.println("Connnection Closed");
+    server.broadcast("A client left");
+  }
+}
+
+void onConnectionCallback(WebsocketsClient& client)
+{
+  (void) client;
+  
+  Serial.print("New client, connections = ");
+  Serial.println(server.getConnectionsCount());
+  
+  server.broadcast("A client joined");
+}
+
+void heartBeatPrint(void)
+{
+  static int num = 1;
+
+  if (WiFi.status() == WL_CONNECTED)
+    Serial.print("H");        // H means server WiFi connected
+  else  
+    Serial.print("F");        // F means server WiFi not connected
+    
+  if (num == 80)
+  {
+    Serial.println();
+    num = 1;
+  }
+  else if (num++ % 10 == 0)
+  {
+    Serial.print(" ");
+  }
+}
+
+void check_status()
+{
+  static unsigned long checkstatus_timeout = 0;
+
+  //KH
+#define HEARTBEAT_INTERVAL    10000L
+  // Print hearbeat every HEARTBEAT_INTERVAL (10) seconds.
+  if ((millis() > checkstatus_timeout) || (checkstatus_timeout == 0))
+  {
+    heartBeatPrint();
+    checkstatus_timeout = millis() + HEARTBEAT_INTERVAL;
+  }
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial);
+
+  Serial.print("\nStart ESP32-MultiClientServer on "); Serial.println(ARDUINO_BOARD);
+  Serial.println(WEBSOCKETS2_GENERIC_VERSION);
+
+  WiFi.mode(WIFI_STA);
+  
+  WiFi.config(serverIP, static_GW, static_SN); 
+  
+  // Connect to wifi
+  WiFi.begin(ssid, password);
+
+  // Wait some time to connect to wifi
+  for (int i = 0; i < 15 && WiFi.status() != WL_CONNECTED; i++)
+  {
+    Serial.print(".");
+    delay(1000);
+  }
+
+  if (WiFi.status() == WL_CONNECTED)
+    Serial.println("\nWiFi connected");
+  else
+  {
+    Serial.println("\nNo WiFi");
+    return;
+  }
+
+  // Every accepted client gets these callbacks
+  server.onMessage(onMessageCallback);
+  server.onEvent(onEventsCallback);
+  server.onConnection(onConnectionCallback);
+  server.setMaxConnections(4);
+  
+  server.listen(WEBSOCKETS_PORT);
+  
+  Serial.print(server.available() ? "WebSockets Server Running and Ready on " : "Server Not Running on ");
+  Serial.println(BOARD_NAME);
+  Serial.print("IP address: ");
+  Serial.print(WiFi.localIP());     //You can get IP address assigned to SAMD
+  Serial.print(", Port: ");
+  Serial.println(WEBSOCKETS_PORT);    // Websockets Server Port
+}
+
+void loop()
+{ 
+  check_status();
+  
+  // Accepts new clients and serves all the connected ones
+  server.poll();
+}
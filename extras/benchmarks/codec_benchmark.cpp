@@ -0,0 +1,431 @@
+/****************************************************************************************************************************
+  codec_benchmark.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+/****************************************************************************************************************************
+  Host microbenchmarks of the frame codec, masking, handshake crypto (websocketsHandshakeEncodeKey, base64Encode / base64Decode) and fragment aggregation.
+
+  Built by extras/host (target codec_benchmark), run as:
+    codec_benchmark [MB per measurement]        (default 64)
+
+  Output is CSV, one line per measurement:
+    benchmark,variant,size,iterations,ns_per_op,mb_per_s,allocs_per_op
+  allocs_per_op counts calls to the global operator new, so it also shows what the payload pool saves.
+ *****************************************************************************************************************************/
+
+#include <WebSockets2_Generic.h>
+#include <Tiny_Websockets_Generic/internals/websockets_endpoint.hpp>
+#include <Tiny_Websockets_Generic/internals/wscrypto/crypto.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <new>
+#include <vector>
+
+using namespace websockets2_generic;
+using namespace websockets2_generic::internals2_generic;
+
+/////////////////////////////////////////////////////////
+
+static uint64_t allocations = 0;
+
+void* operator new(size_t size)
+{
+  allocations++;
+
+  void* p = malloc(size ? size : 1);
+
+  if (p == nullptr)
+    throw std::bad_alloc();
+
+  return p;
+}
+
+void* operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+  free(p);
+}
+
+/////////////////////////////////////////////////////////
+
+// Sends go nowhere, reads replay `stream` over and over
+class BenchClient : public network2_generic::TcpClient
+{
+  public:
+    std::vector<uint8_t>  stream;
+    bool                  recording = false;
+
+    bool poll() override
+    {
+      return !this->stream.empty();
+    }
+
+    bool available() override
+    {
+      return true;
+    }
+
+    bool send(const WSString& data) override
+    {
+      return send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+    }
+
+    bool send(const WSString&& data) override
+    {
+      return send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+    }
+
+    bool send(const uint8_t* data, const uint32_t len) override
+    {
+      if (this->recording)
+        this->stream.insert(this->stream.end(), data, data + len);
+
+      return true;
+    }
+
+    bool sendSegments(const network2_generic::TcpSegment* segments, const size_t count) override
+    {
+      for (size_t i = 0; i < count; i++)
+      {
+        send(segments[i].data, segments[i].len);
+      }
+
+      return true;
+    }
+
+    WSString readLine() override
+    {
+      return WSString();
+    }
+
+    uint32_t read(uint8_t* buffer, const uint32_t len) override
+    {
+      if (this->stream.empty())
+        return static_cast<uint32_t>(-1);
+
+      uint32_t left   = static_cast<uint32_t>(this->stream.size() - this->_position);
+      uint32_t count  = (len < left) ? len : left;
+
+      memcpy(buffer, this->stream.data() + this->_position, count);
+
+      this->_position = (this->_position + count) % this->stream.size();
+
+      return count;
+    }
+
+    bool connect(const WSString&, int) override
+    {
+      return true;
+    }
+
+    void close() override {}
+
+  protected:
+    int getSocket() const override
+    {
+      return -1;
+    }
+
+  private:
+    size_t _position = 0;
+};
+
+/////////////////////////////////////////////////////////
+
+struct Measurement
+{
+  uint64_t  iterations  = 0;
+  uint64_t  ns          = 0;
+  uint64_t  allocs      = 0;
+
+  std::chrono::steady_clock::time_point start;
+  uint64_t                              startAllocs = 0;
+
+  void begin()
+  {
+    this->startAllocs = allocations;
+    this->start       = std::chrono::steady_clock::now();
+  }
+
+  void end()
+  {
+    auto elapsed = std::chrono::steady_clock::now() - this->start;
+
+    this->ns     += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    this->allocs += allocations - this->startAllocs;
+  }
+
+  void report(const char* benchmark, const char* variant, size_t size) const
+  {
+    double nsPerOp = (double) this->ns / this->iterations;
+
+    printf("%s,%s,%zu,%llu,%.1f,%.1f,%.2f\n", benchmark, variant, size, (unsigned long long) this->iterations,
+           nsPerOp, nsPerOp > 0 ? (size * 1000.0) / nsPerOp : 0.0, (double) this->allocs / this->iterations);
+  }
+};
+
+static size_t traffic = 64UL * 1024 * 1024;
+
+// Enough iterations for `traffic` bytes, at least 100
+static uint64_t iterationsFor(size_t size)
+{
+  uint64_t iterations = traffic / (size + 64);
+
+  return (iterations < 100) ? 100 : iterations;
+}
+
+// Keeps results alive without printing them
+static volatile size_t sink;
+
+static const size_t     sizes[]   = { 0, 16, 125, 126, 1024, 16384, 65535, 65536, 1048576 };
+static const char       key[4]    = { 0x37, (char) 0xfa, 0x21, 0x3d };
+
+/////////////////////////////////////////////////////////
+
+static void benchSend(size_t size, bool mask)
+{
+  auto client = std::make_shared<BenchClient>();
+  WebsocketsEndpoint endpoint(client);
+  std::vector<char> payload(size + 1, 'x');
+  Measurement m;
+
+  m.iterations = iterationsFor(size);
+  m.begin();
+
+  for (uint64_t i = 0; i < m.iterations; i++)
+  {
+    endpoint.send(payload.data(), size, internals2_generic::ContentType::Binary, true, mask, key);
+  }
+
+  m.end();
+  m.report("endpoint_send", mask ? "masked" : "unmasked", size);
+}
+
+static void benchRecv(size_t size, bool mask)
+{
+  auto client = std::make_shared<BenchClient>();
+  WebsocketsEndpoint endpoint(client);
+  std::vector<char> payload(size + 1, 'x');
+
+  // One encoded frame, replayed by the client for every recv()
+  client->recording = true;
+  endpoint.send(payload.data(), size, internals2_generic::ContentType::Binary, true, mask, key);
+  client->recording = false;
+
+  Measurement m;
+
+  m.iterations = iterationsFor(size);
+  m.begin();
+
+  for (uint64_t i = 0; i < m.iterations; i++)
+  {
+    WebsocketsMessage message;
+
+    while (message.isEmpty())
+    {
+      message = endpoint.recv();
+    }
+
+    sink = message.length();
+  }
+
+  m.end();
+  m.report("endpoint_recv", mask ? "masked" : "unmasked", size);
+}
+
+static void benchRemask(size_t size)
+{
+  WSString data(size, 'x');
+  Measurement m;
+
+  m.iterations = iterationsFor(size);
+  m.begin();
+
+  for (uint64_t i = 0; i < m.iterations; i++)
+  {
+    remaskData(data, reinterpret_cast<const uint8_t*>(key), size);
+  }
+
+  m.end();
+  sink = data[0];
+  m.report("remaskData", "-", size);
+}
+
+static void benchHandshakeKey()
+{
+  const char* clientKey = "dGhlIHNhbXBsZSBub25jZQ==";
+  char accept[30];
+  Measurement m;
+
+  m.iterations = 200000;
+  m.begin();
+
+  for (uint64_t i = 0; i < m.iterations; i++)
+  {
+    crypto2_generic::websocketsHandshakeEncodeKey(clientKey, accept);
+  }
+
+  m.end();
+  sink = accept[0];
+  m.report("websocketsHandshakeEncodeKey", "-", strlen(clientKey));
+}
+
+static void benchBase64(size_t size)
+{
+  std::vector<uint8_t> bytes(size + 1);
+
+  for (size_t i = 0; i < size; i++)
+  {
+    bytes[i] = (uint8_t) (i * 31 + 7);
+  }
+
+  Measurement m;
+
+  m.iterations = iterationsFor(size);
+  m.begin();
+
+  for (uint64_t i = 0; i < m.iterations; i++)
+  {
+    sink = crypto2_generic::base64Encode(bytes.data(), size).size();
+  }
+
+  m.end();
+  m.report("base64Encode", "-", size);
+
+  WSString text = crypto2_generic::base64Encode(bytes.data(), size);
+  Measurement d;
+
+  d.iterations = iterationsFor(size);
+  d.begin();
+
+  for (uint64_t i = 0; i < d.iterations; i++)
+  {
+    sink = crypto2_generic::base64Decode(text).size();
+  }
+
+  d.end();
+  d.report("base64Decode", "-", size);
+}
+
+static void benchStreamBuilder(size_t fragments, size_t fragmentSize)
+{
+  Measurement m;
+  char variant[32];
+
+  m.iterations = iterationsFor(fragments * fragmentSize);
+
+  std::vector<WebsocketsFrame> frames(fragments);
+
+  for (uint64_t i = 0; i < m.iterations; i++)
+  {
+    // Building the frames is not measured, only the aggregation
+    for (size_t f = 0; f < fragments; f++)
+    {
+      frames[f].fin             = (f == fragments - 1);
+      frames[f].opcode          = (f == 0) ? internals2_generic::ContentType::Binary : internals2_generic::ContentType::Continuation;
+      frames[f].mask            = 0;
+      frames[f].payload_length  = fragmentSize;
+      frames[f].payload         = WSString(fragmentSize, 'x');
+    }
+
+    m.begin();
+
+    WebsocketsMessage::StreamBuilder builder;
+
+    builder.first(frames[0]);
+
+    for (size_t f = 1; f < fragments - 1; f++)
+    {
+      builder.append(frames[f]);
+    }
+
+    builder.end(frames[fragments - 1]);
+
+    sink = builder.build().length();
+
+    m.end();
+  }
+
+  snprintf(variant, sizeof(variant), "fragments=%zu", fragments);
+  m.report("StreamBuilder", variant, fragments * fragmentSize);
+}
+
+/////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+  if (argc > 1)
+    traffic = (size_t) atol(argv[1]) * 1024 * 1024;
+
+  printf("benchmark,variant,size,iterations,ns_per_op,mb_per_s,allocs_per_op\n");
+
+  for (size_t size : sizes)
+  {
+    benchSend(size, false);
+    benchSend(size, true);
+  }
+
+  for (size_t size : sizes)
+  {
+    benchRecv(size, false);
+    benchRecv(size, true);
+  }
+
+  for (size_t size : sizes)
+  {
+    benchRemask(size);
+  }
+
+  benchHandshakeKey();
+
+  for (size_t size : { 16, 1024, 65536 })
+  {
+    benchBase64(size);
+  }
+
+  for (size_t fragments : { 2, 16, 128 })
+  {
+    benchStreamBuilder(fragments, 1024);
+  }
+
+  return 0;
+}
@@ -0,0 +1,134 @@
+/****************************************************************************************************************************
+  mask_benchmark.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+/****************************************************************************************************************************
+  Host benchmark of the RFC6455 masking kernel (maskPayload) against the previous byte-by-byte loop.
+
+  Build and run (from this directory):
+    g++ -O2 -std=c++11 -I../../src mask_benchmark.cpp -o mask_benchmark && ./mask_benchmark
+
+  Reports bytes/cycle (x86, using the TSC) or bytes/ns (other hosts) for several payload sizes and
+  head alignments. Output is CSV.
+ *****************************************************************************************************************************/
+
+#include <Tiny_Websockets_Generic/internals/ws_mask.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if ( defined(__x86_64__) || defined(__i386__) )
+  #include <x86intrin.h>
+  #define BENCH_UNIT    "bytes/cycle"
+  static inline uint64_t benchNow()
+  {
+    return __rdtsc();
+  }
+#else
+  #define BENCH_UNIT    "bytes/ns"
+  static inline uint64_t benchNow()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+#endif
+
+using websockets2_generic::internals2_generic::maskPayload;
+
+// The loop remaskData() used before the kernel was introduced
+static void __attribute__((noinline)) maskBytewise(uint8_t* data, uint64_t len, const uint8_t* maskingKey)
+{
+  for (uint64_t i = 0; i < len; i++)
+  {
+    data[i] = data[i] ^ maskingKey[i % 4];
+  }
+}
+
+static void __attribute__((noinline)) maskKernel(uint8_t* data, uint64_t len, const uint8_t* maskingKey)
+{
+  maskPayload(data, len, maskingKey);
+}
+
+template <class Fn> static double measure(Fn fn, uint8_t* data, size_t len, const uint8_t* key)
+{
+  // Enough iterations for roughly 64 MB of traffic per measurement
+  const size_t iterations = (64UL * 1024 * 1024) / (len + 1) + 1;
+
+  fn(data, len, key);
+
+  const uint64_t start = benchNow();
+
+  for (size_t i = 0; i < iterations; i++)
+  {
+    fn(data, len, key);
+  }
+
+  const uint64_t elapsed = benchNow() - start;
+
+  return (static_cast<double>(len) * iterations) / (elapsed ? elapsed : 1);
+}
+
+int main()
+{
+  const uint8_t key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+  const size_t sizes[] = { 7, 64, 125, 512, 4096, 65536, 1048576 };
+
+  std::vector<uint8_t> storage(1048576 + 64);
+  std::vector<uint8_t> expected(storage.size());
+
+  for (size_t i = 0; i < storage.size(); i++)
+  {
+    storage[i] = static_cast<uint8_t>(rand());
+  }
+
+  printf("size,head_offset,bytewise_%s,kernel_%s,speedup\n", BENCH_UNIT, BENCH_UNIT);
+
+  for (size_t size : sizes)
+  {
+    for (size_t headOffset : { 0, 3 })
+    {
+      uint8_t* data = storage.data() + headOffset;
+
+      // Sanity check: both versions must produce the same bytes
+      expected.assign(data, data + size);
+      maskBytewise(expected.data(), size, key);
+      maskKernel(data, size, key);
+
+      for (size_t i = 0; i < size; i++)
+      {
+        if (data[i] != expected[i])
+        {
+          fprintf(stderr, "Mismatch at size %zu, offset %zu, byte %zu\n", size, headOffset, i);
+          return 1;
+        }
+      }
+
+      const double before = measure(maskBytewise, data, size, key);
+      const double after  = measure(maskKernel, data, size, key);
+
+      printf("%zu,%zu,%.3f,%.3f,%.2f\n", size, headOffset, before, after, after / before);
+    }
+  }
+
+  return 0;
+}
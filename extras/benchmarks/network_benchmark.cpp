@@ -0,0 +1,213 @@
+/****************************************************************************************************************************
+  network_benchmark.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+/****************************************************************************************************************************
+  Client behaviour under simulated network conditions: the client's transport is a SimulatedTcpClient
+  over the in-memory loopback, the server runs in the same thread.
+
+  Built by extras/host (target network_benchmark), run as:
+    network_benchmark [messages] [size] [seed]        (defaults: 10 512 1)
+
+  For each profile (ideal, wifi = NetworkConditions::CongestedWifi(), 2g = NetworkConditions::Cellular2G(),
+  flaky = wifi cut after up to 16 KB) measures, in ms:
+    handshake       connectAsync() until the connection is open, both ends polled
+    rtt             one message and its echo through poll(), averaged over 5
+    poll_burst      `messages` sent at once until every echo came through poll()
+    blocking_burst  the same, the echoes read with readBlocking() once the server has answered
+  Output is CSV. A phase that doesn't finish within 60 s, or after the connection dropped, reports -1.
+ *****************************************************************************************************************************/
+
+#include <WebSockets2_Generic.h>
+#include <Tiny_Websockets_Generic/network/loopback/loopback_tcp.hpp>
+#include <Tiny_Websockets_Generic/network/simulated/simulated_tcp.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+using namespace websockets2_generic;
+using namespace websockets2_generic::network2_generic;
+
+#define BENCH_PORT        80
+#define PHASE_TIMEOUT     60000UL
+
+struct Profile
+{
+  const char*       name;
+  NetworkConditions conditions;
+};
+
+static int messages = 10;
+static std::string payload;
+
+// Polls both ends until `done` or the phase times out, returns the elapsed ms or -1
+template <class Done> static long pollUntil(WebsocketsServer& server, WebsocketsClient& client, unsigned long start, Done done)
+{
+  while (!done())
+  {
+    if (!client.available() && !client.isConnecting())
+      return -1;
+
+    if (millis() - start > PHASE_TIMEOUT)
+      return -1;
+
+    server.poll();
+    client.poll();
+  }
+
+  return (long) (millis() - start);
+}
+
+static void run(const Profile& profile)
+{
+  auto network = std::make_shared<LoopbackNetwork>();
+  auto tcp     = std::make_shared<SimulatedTcpClient>(std::make_shared<LoopbackTcpClient>(network), profile.conditions);
+
+  WebsocketsServer server(new LoopbackTcpServer(network));
+  WebsocketsClient client(tcp);
+
+  int received  = 0;
+  int echoes    = 0;
+
+  server.onMessage([&](WebsocketsClient& peer, WebsocketsMessage message)
+  {
+    received++;
+    peer.sendBinary(message.c_str(), message.length());
+  });
+
+  client.onMessage([&](WebsocketsClient&, WebsocketsMessage)
+  {
+    echoes++;
+  });
+
+  server.listen(BENCH_PORT);
+
+  long handshake = -1, rtt = -1, pollBurst = -1, blockingBurst = -1;
+
+  client.connectAsync("loopback", BENCH_PORT, "/");
+  handshake = pollUntil(server, client, millis(), [&] { return !client.isConnecting(); });
+
+  if (!client.available())
+    handshake = -1;
+
+  if (handshake >= 0)
+  {
+    long total = 0;
+
+    for (int i = 0; i < 5 && total >= 0; i++)
+    {
+      int expected = echoes + 1;
+
+      client.sendBinary(payload.data(), payload.size());
+
+      long elapsed = pollUntil(server, client, millis(), [&] { return echoes >= expected; });
+
+      total = (elapsed < 0) ? -1 : total + elapsed;
+    }
+
+    rtt = (total < 0) ? -1 : total / 5;
+  }
+
+  if (rtt >= 0)
+  {
+    int expected = echoes + messages;
+    unsigned long start = millis();
+
+    for (int i = 0; i < messages; i++)
+    {
+      client.sendBinary(payload.data(), payload.size());
+    }
+
+    pollBurst = pollUntil(server, client, start, [&] { return echoes >= expected; });
+  }
+
+  if (pollBurst >= 0)
+  {
+    int expected = received + messages;
+    unsigned long start = millis();
+
+    for (int i = 0; i < messages; i++)
+    {
+      client.sendBinary(payload.data(), payload.size());
+    }
+
+    // The transport alone is polled, so the echoes are left for readBlocking()
+    while (received < expected && client.available() && millis() - start < PHASE_TIMEOUT)
+    {
+      server.poll();
+      tcp->poll();
+    }
+
+    int read = 0;
+
+    while (read < messages && client.available())
+    {
+      if (!client.readBlocking().isEmpty())
+        read++;
+    }
+
+    blockingBurst = (read == messages) ? (long) (millis() - start) : -1;
+  }
+
+  printf("%s,%ld,%ld,%ld,%ld,%llu,%s\n", profile.name, handshake, rtt, pollBurst, blockingBurst,
+         (unsigned long long) tcp->getTransferred(), client.available() ? "open" : "dropped");
+
+  client.close();
+  server.poll();
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t seed = 1;
+
+  if (argc > 1)
+    messages = atoi(argv[1]);
+
+  payload.assign((argc > 2) ? (size_t) atol(argv[2]) : 512, 'x');
+
+  if (argc > 3)
+    seed = (uint32_t) atol(argv[3]);
+
+  Profile profiles[] =
+  {
+    { "ideal",  NetworkConditions() },
+    { "wifi",   NetworkConditions::CongestedWifi() },
+    { "2g",     NetworkConditions::Cellular2G() },
+    { "flaky",  NetworkConditions::CongestedWifi() },
+  };
+
+  profiles[3].conditions.dropAfter = 16 * 1024;
+
+  for (Profile& profile : profiles)
+  {
+    profile.conditions.seed = seed;
+  }
+
+  printf("profile,handshake_ms,rtt_ms,poll_burst_ms,blocking_burst_ms,bytes,connection\n");
+
+  for (const Profile& profile : profiles)
+  {
+    run(profile);
+  }
+
+  return 0;
+}
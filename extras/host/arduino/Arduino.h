@@ -0,0 +1,190 @@
+/****************************************************************************************************************************
+  Arduino.h
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+/****************************************************************************************************************************
+  Minimal Arduino core for host builds (extras/host). Only what the library and the host examples use:
+  String, millis(), micros(), delay(), yield(), random() and a Serial that prints to stdout.
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#ifndef _WS_HOST_ARDUINO_H
+#define _WS_HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+/////////////////////////////////////////////////////
+
+class String
+{
+  public:
+    String() {}
+    String(const char* cstr) : _str(cstr ? cstr : "") {}
+    String(const char* cstr, size_t len) : _str(cstr, len) {}
+    String(const std::string& str) : _str(str) {}
+    String(char c) : _str(1, c) {}
+    String(int value) : _str(std::to_string(value)) {}
+    String(unsigned int value) : _str(std::to_string(value)) {}
+    String(long value) : _str(std::to_string(value)) {}
+    String(unsigned long value) : _str(std::to_string(value)) {}
+
+    const char* c_str() const
+    {
+      return _str.c_str();
+    }
+
+    unsigned int length() const
+    {
+      return _str.length();
+    }
+
+    char operator[](unsigned int index) const
+    {
+      return _str[index];
+    }
+
+    String& operator+=(const String& rhs)
+    {
+      _str += rhs._str;
+      return *this;
+    }
+
+    String& operator+=(const char* rhs)
+    {
+      _str += rhs;
+      return *this;
+    }
+
+    String& operator+=(char c)
+    {
+      _str += c;
+      return *this;
+    }
+
+    bool operator==(const String& rhs) const
+    {
+      return _str == rhs._str;
+    }
+
+    bool operator!=(const String& rhs) const
+    {
+      return _str != rhs._str;
+    }
+
+    friend String operator+(const String& lhs, const String& rhs)
+    {
+      return String(lhs._str + rhs._str);
+    }
+
+    friend String operator+(const char* lhs, const String& rhs)
+    {
+      return String(lhs + rhs._str);
+    }
+
+    friend String operator+(const String& lhs, const char* rhs)
+    {
+      return String(lhs._str + rhs);
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const String& str)
+    {
+      return os << str._str;
+    }
+
+  private:
+    std::string _str;
+};
+
+/////////////////////////////////////////////////////
+
+inline unsigned long millis()
+{
+  static const auto start = std::chrono::steady_clock::now();
+
+  return (unsigned long) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline unsigned long micros()
+{
+  static const auto start = std::chrono::steady_clock::now();
+
+  return (unsigned long) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline void delay(unsigned long ms)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline void yield()
+{
+  std::this_thread::yield();
+}
+
+inline long random(long howbig)
+{
+  return (howbig <= 0) ? 0 : (::rand() % howbig);
+}
+
+inline long random(long howsmall, long howbig)
+{
+  return (howsmall >= howbig) ? howsmall : (howsmall + random(howbig - howsmall));
+}
+
+/////////////////////////////////////////////////////
+
+class HostSerial
+{
+  public:
+    void begin(unsigned long) {}
+
+    template<class T> void print(const T& value)
+    {
+      std::cout << value;
+    }
+
+    template<class T> void println(const T& value)
+    {
+      std::cout << value << std::endl;
+    }
+
+    void println()
+    {
+      std::cout << std::endl;
+    }
+
+    operator bool() const
+    {
+      return true;
+    }
+};
+
+static HostSerial Serial;
+
+#endif    // _WS_HOST_ARDUINO_H
@@ -0,0 +1,87 @@
+/****************************************************************************************************************************
+  EchoClient.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+/****************************************************************************************************************************
+  Host echo client on the Linux socket backend, to go with EchoServer.
+
+  Usage: EchoClient [host] [port] [messages]        (defaults: localhost 8080 10)
+
+  Sends the given number of text messages and waits for every echo. Exits with 0 when all came back.
+ *****************************************************************************************************************************/
+
+#include <WebSockets2_Generic.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace websockets2_generic;
+
+#define WEBSOCKETS_HOST     "localhost"
+#define WEBSOCKETS_PORT     8080
+#define ECHO_TIMEOUT_MS     5000
+
+WebsocketsClient client;
+
+int main(int argc, char** argv)
+{
+  const char* host  = (argc > 1) ? argv[1] : WEBSOCKETS_HOST;
+  int port          = (argc > 2) ? atoi(argv[2]) : WEBSOCKETS_PORT;
+  int messages      = (argc > 3) ? atoi(argv[3]) : 10;
+  int echoes        = 0;
+
+  client.onMessage([&](WebsocketsClient&, WebsocketsMessage message)
+  {
+    Serial.print("Got Message: ");
+    Serial.println(message.data());
+    echoes++;
+  });
+
+  if (!client.connect(host, port, "/"))
+  {
+    Serial.print("Can't connect to ");
+    Serial.println(host);
+    return 1;
+  }
+
+  for (int i = 0; i < messages; i++)
+  {
+    char buf[32];
+    int len = snprintf(buf, sizeof(buf), "Hello %d", i);
+
+    client.send(buf, len);
+  }
+
+  unsigned long start = millis();
+
+  while ( (echoes < messages) && client.available() && (millis() - start < ECHO_TIMEOUT_MS) )
+  {
+    client.poll();
+    delay(1);
+  }
+
+  client.close();
+
+  Serial.print("Echoes: ");
+  Serial.println(echoes);
+
+  return (echoes == messages) ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+/****************************************************************************************************************************
+  EchoServer.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+/****************************************************************************************************************************
+  Host echo server on the Linux socket backend.
+
+  Usage: EchoServer [port]        (default port 8080)
+
+  Accepts any number of clients and echoes every message back to its sender, using the
+  callback/poll API of WebsocketsServer.
+ *****************************************************************************************************************************/
+
+#include <WebSockets2_Generic.h>
+
+#include <stdlib.h>
+
+using namespace websockets2_generic;
+
+#define WEBSOCKETS_PORT     8080
+
+WebsocketsServer server;
+
+int main(int argc, char** argv)
+{
+  uint16_t port = (argc > 1) ? (uint16_t) atoi(argv[1]) : WEBSOCKETS_PORT;
+
+  Serial.println(WEBSOCKETS2_GENERIC_VERSION);
+
+  server.onConnection([](WebsocketsClient&)
+  {
+    Serial.println("Client connected");
+  });
+
+  server.onMessage([](WebsocketsClient& client, WebsocketsMessage message)
+  {
+    if (message.isBinary())
+    {
+      client.sendBinary(message.c_str(), message.length());
+    }
+    else
+    {
+      client.send(message.c_str(), message.length());
+    }
+  });
+
+  server.listen(port);
+
+  if (!server.available())
+  {
+    Serial.print("Server Not Running on port ");
+    Serial.println(port);
+    return 1;
+  }
+
+  Serial.print("WebSockets Server Running and Ready on port ");
+  Serial.println(port);
+
+  while (server.available())
+  {
+    server.poll();
+    delay(1);
+  }
+
+  return 0;
+}
@@ -0,0 +1,124 @@
+/****************************************************************************************************************************
+  LoopbackEcho.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+/****************************************************************************************************************************
+  Client and server in one process over the in-memory loopback transport, no sockets involved.
+
+  Usage: LoopbackEcho [messages] [size] [maxChunk] [seed]        (defaults: 1000 1024 0 0)
+
+  The client sends the given number of binary messages, the server echoes them back, and the client
+  checks every echo. maxChunk / seed split the reads on both ends (see LoopbackNetwork::setChunking()).
+  Prints the round trip throughput, exits with 0 when every echo matched.
+ *****************************************************************************************************************************/
+
+#include <WebSockets2_Generic.h>
+#include <Tiny_Websockets_Generic/network/loopback/loopback_tcp.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+
+using namespace websockets2_generic;
+using namespace websockets2_generic::network2_generic;
+
+#define LOOPBACK_PORT     80
+
+int main(int argc, char** argv)
+{
+  int       messages  = (argc > 1) ? atoi(argv[1]) : 1000;
+  size_t    size      = (argc > 2) ? (size_t) atol(argv[2]) : 1024;
+  uint32_t  maxChunk  = (argc > 3) ? (uint32_t) atol(argv[3]) : 0;
+  uint32_t  seed      = (argc > 4) ? (uint32_t) atol(argv[4]) : 0;
+  
+  auto network = std::make_shared<LoopbackNetwork>();
+  
+  network->setChunking(maxChunk, seed);
+  
+  WebsocketsServer server(new LoopbackTcpServer(network));
+  WebsocketsClient client(std::make_shared<LoopbackTcpClient>(network));
+  
+  server.onMessage([](WebsocketsClient& peer, WebsocketsMessage message)
+  {
+    peer.sendBinary(message.c_str(), message.length());
+  });
+  
+  server.listen(LOOPBACK_PORT);
+  
+  std::string payload(size, '\0');
+  
+  for (size_t i = 0; i < size; i++)
+  {
+    payload[i] = (char) (i * 7 + 1);
+  }
+  
+  int echoes      = 0;
+  int mismatches  = 0;
+  
+  client.onMessage([&](WebsocketsClient&, WebsocketsMessage message)
+  {
+    if (message.length() != payload.size() || memcmp(message.c_str(), payload.data(), payload.size()) != 0)
+      mismatches++;
+    
+    echoes++;
+  });
+  
+  client.connectAsync("loopback", LOOPBACK_PORT, "/");
+  
+  // Nothing blocks, the two ends take turns
+  while (client.isConnecting())
+  {
+    server.poll();
+    client.poll();
+  }
+  
+  if (!client.available())
+  {
+    Serial.println("Loopback handshake failed");
+    return 1;
+  }
+  
+  auto start = std::chrono::steady_clock::now();
+  
+  for (int i = 0; i < messages; i++)
+  {
+    client.sendBinary(payload.data(), payload.size());
+    server.poll();
+    client.poll();
+  }
+  
+  while (echoes < messages && client.available())
+  {
+    server.poll();
+    client.poll();
+  }
+  
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  
+  client.close();
+  server.poll();
+  
+  printf("messages=%d size=%zu maxChunk=%u seed=%u echoes=%d mismatches=%d MB/s=%.1f\n", messages, size, 
+         maxChunk, seed, echoes, mismatches, (2.0 * messages * size) / (seconds * 1e6));
+  
+  return (echoes == messages && mismatches == 0) ? 0 : 1;
+}
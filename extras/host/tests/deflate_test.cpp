@@ -0,0 +1,320 @@
+/****************************************************************************************************************************
+  deflate_test.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+/****************************************************************************************************************************
+  permessage-deflate (RFC 7692): extension negotiation, the inflater on the examples of section 7.2.3,
+  compress / decompress round trips with and without context takeover, malformed input, and a decompression
+  bomb that must stop at _WS_DEFLATE_MAX_MESSAGE_SIZE and close the connection with 1009.
+
+  Built as its own translation unit with _WS_CONFIG_PERMESSAGE_DEFLATE, whatever WS_HOST_PERMESSAGE_DEFLATE says.
+ *****************************************************************************************************************************/
+
+#ifndef _WS_CONFIG_PERMESSAGE_DEFLATE
+  #define _WS_CONFIG_PERMESSAGE_DEFLATE
+#endif
+
+#include <WebSockets2_Generic.h>
+#include <Tiny_Websockets_Generic/internals/websockets_endpoint.hpp>
+#include <Tiny_Websockets_Generic/network/loopback/loopback_tcp.hpp>
+
+#include "ws_test.hpp"
+
+#include <string>
+
+using namespace websockets2_generic;
+using namespace websockets2_generic::internals2_generic;
+using namespace websockets2_generic::network2_generic;
+
+static InflateResult inflate(PerMessageDeflate& deflate, const std::string& data, std::string& out)
+{
+  WSString message;
+  InflateResult result = deflate.decompress(reinterpret_cast<const uint8_t*>(data.data()), data.size(), message);
+
+  out.assign(message.data(), message.size());
+
+  return result;
+}
+
+static std::string compress(PerMessageDeflate& deflate, const std::string& data)
+{
+  WSString out;
+
+  if (!deflate.compress(reinterpret_cast<const uint8_t*>(data.data()), data.size(), out))
+    return std::string();
+
+  return std::string(out.data(), out.size());
+}
+
+// Something that compresses, but not trivially
+static std::string sample(const size_t length, uint32_t seed)
+{
+  std::string text;
+
+  while (text.size() < length)
+  {
+    seed = seed * 1103515245 + 12345;
+
+    if ((seed >> 16) % 4 == 0)
+      text += (char) (seed >> 8);
+    else
+      text += "{\"temp\":" + std::to_string((seed >> 16) % 100) + ",\"id\":\"sensor\"},";
+  }
+
+  text.resize(length);
+
+  return text;
+}
+
+// Sec-WebSocket-Extensions negotiation, both sides
+static void testNegotiation()
+{
+  DeflateParams params;
+  WSString      response;
+
+  WS_CHECK(deflateParseResponse("", params) && !params.enabled);
+  WS_CHECK(deflateParseResponse("Permessage-Deflate; Server_No_Context_Takeover", params));
+  WS_CHECK(params.enabled && params.serverNoContextTakeover);
+  WS_CHECK(deflateParseResponse("permessage-deflate; server_max_window_bits=\"9\"", params));
+  WS_CHECK(params.serverMaxWindowBits == 9);
+
+  // Takes neither offer, or more than one element
+  WS_CHECK(!deflateParseResponse("permessage-deflate", params));
+  WS_CHECK(!deflateParseResponse("permessage-deflate; server_max_window_bits=15", params));
+  WS_CHECK(!deflateParseResponse("permessage-deflate; server_no_context_takeover, permessage-deflate", params));
+  WS_CHECK(!deflateParseResponse("permessage-deflate; server_no_context_takeover; foo", params));
+
+  // Our own offer is accepted, and so is the first usable one of a list
+  WS_CHECK(deflateAcceptOffer(deflateClientOffer().c_str(), params, response));
+  WS_CHECK(params.serverNoContextTakeover && params.clientNoContextTakeover);
+  WS_CHECK(!deflateAcceptOffer("x-webkit-deflate-frame, permessage-deflate; server_max_window_bits=8;", params, response));
+  WS_CHECK(deflateAcceptOffer("x-webkit-deflate-frame, permessage-deflate; client_max_window_bits; server_max_window_bits=9",
+                              params, response));
+  WS_CHECK(params.serverMaxWindowBits == 9 && params.clientMaxWindowBits == 15);
+  WS_CHECK(response == "permessage-deflate; client_no_context_takeover; server_max_window_bits=9");
+
+  WS_CHECK(!deflateAcceptOffer("permessage-deflate; server_max_window_bits", params, response));
+  WS_CHECK(!deflateAcceptOffer("", params, response));
+}
+
+static void testRfcExamples()
+{
+  DeflateParams params;
+
+  params.enabled = true;
+
+  PerMessageDeflate deflate(params, false);
+  std::string out;
+
+  // 7.2.3.1, "Hello" in a compressed block
+  WS_CHECK(inflate(deflate, std::string("\xf2\x48\xcd\xc9\xc9\x07\x00", 7), out) == InflateResult_Ok);
+  WS_CHECK(out == "Hello");
+
+  // 7.2.3.2, the same message again, referring to the first one through the shared window
+  WS_CHECK(inflate(deflate, std::string("\xf2\x00\x11\x00\x00", 5), out) == InflateResult_Ok);
+  WS_CHECK(out == "Hello");
+
+  // 7.2.3.3, "Hello" in a stored block
+  PerMessageDeflate stored(params, false);
+
+  WS_CHECK(inflate(stored, std::string("\x00\x05\x00\xfa\xff\x48\x65\x6c\x6c\x6f\x00", 11), out) == InflateResult_Ok);
+  WS_CHECK(out == "Hello");
+
+  // 7.2.3.5, BFINAL set
+  PerMessageDeflate lastBlock(params, false);
+
+  WS_CHECK(inflate(lastBlock, std::string("\xf3\x48\xcd\xc9\xc9\x07\x00", 7), out) == InflateResult_Ok);
+  WS_CHECK(out == "Hello");
+}
+
+static void testRoundTrip()
+{
+  for (int takeover = 0; takeover < 2; takeover++)
+  {
+    DeflateParams params;
+
+    params.enabled                  = true;
+    params.serverNoContextTakeover  = (takeover == 0);
+    params.clientNoContextTakeover  = (takeover == 0);
+
+    PerMessageDeflate client(params, false);
+    PerMessageDeflate server(params, true);
+
+    client.setThreshold(0);
+
+    const size_t lengths[] = { 1, 10, 100, 1000, 5000, 40000, 100000 };
+
+    for (size_t length : lengths)
+    {
+      const std::string message     = sample(length, (uint32_t) length);
+      const std::string compressed  = compress(client, message);
+      std::string back;
+
+      if (compressed.empty())
+      {
+        // Incompressible, sent as is
+        WS_CHECK(length < 100);
+        continue;
+      }
+
+      WS_CHECK(compressed.size() < message.size());
+      WS_CHECK(inflate(server, compressed, back) == InflateResult_Ok);
+      WS_CHECK(back == message);
+    }
+
+    const std::string zeros(100000, '\0');
+    std::string back;
+
+    WS_CHECK(inflate(server, compress(client, zeros), back) == InflateResult_Ok);
+    WS_CHECK(back == zeros);
+  }
+}
+
+static void testBadData()
+{
+  DeflateParams params;
+
+  params.enabled                  = true;
+  params.serverNoContextTakeover  = true;
+  params.clientNoContextTakeover  = true;
+
+  PerMessageDeflate deflate(params, true);
+  std::string out;
+
+  // Reserved block type 3
+  WS_CHECK(inflate(deflate, std::string("\x07\x00", 2), out) == InflateResult_BadData);
+  // Stored block whose length and its complement disagree
+  WS_CHECK(inflate(deflate, std::string("\x00\x05\x00\x00\x00Hello", 10), out) == InflateResult_BadData);
+  // Distance beyond the start of the message
+  WS_CHECK(inflate(deflate, std::string("\x02\x10\x00", 3), out) != InflateResult_Ok);
+
+  // Random bytes, must never crash or succeed with garbage left in `out`
+  uint32_t seed = 1;
+
+  for (int i = 0; i < 2000; i++)
+  {
+    std::string noise(i % 200, '\0');
+
+    for (char& c : noise)
+    {
+      seed = seed * 1103515245 + 12345;
+      c = (char) (seed >> 16);
+    }
+
+    if (inflate(deflate, noise, out) != InflateResult_Ok)
+      WS_CHECK(out.empty());
+  }
+}
+
+static void testBomb()
+{
+  DeflateParams params;
+
+  params.enabled                  = true;
+  params.serverNoContextTakeover  = true;
+  params.clientNoContextTakeover  = true;
+
+  PerMessageDeflate client(params, false);
+  PerMessageDeflate server(params, true);
+
+  const std::string bomb = compress(client, std::string(4 * _WS_DEFLATE_MAX_MESSAGE_SIZE, 'a'));
+  std::string out;
+
+  WS_CHECK(!bomb.empty());
+  WS_CHECK(bomb.size() < _WS_DEFLATE_MAX_MESSAGE_SIZE / 16);
+  WS_CHECK(inflate(server, bomb, out) == InflateResult_TooBig);
+  WS_CHECK(out.empty());
+
+  // The same through an endpoint: a small compressed frame, closed with 1009 instead of inflated
+  auto network  = std::make_shared<LoopbackNetwork>();
+  auto toServer = std::make_shared<LoopbackPipe>();
+  auto toClient = std::make_shared<LoopbackPipe>();
+
+  WebsocketsEndpoint endpoint(std::make_shared<LoopbackTcpClient>(network, toServer, toClient));
+
+  endpoint.setDeflate(params, true);
+  endpoint.setUseMasking(false);
+
+  // Binary, RSV1, 64-bit length, no mask
+  std::string frame("\xc2\x7f", 2);
+
+  for (int shift = 56; shift >= 0; shift -= 8)
+  {
+    frame += (char) ((uint64_t) bomb.size() >> shift);
+  }
+
+  frame += bomb;
+  toServer->write(reinterpret_cast<const uint8_t*>(frame.data()), static_cast<uint32_t>(frame.size()));
+
+  WebsocketsMessage message = endpoint.recv();
+
+  WS_CHECK(message.isEmpty());
+  WS_CHECK(endpoint.getCloseReason() == CloseReason_MessageTooBig);
+}
+
+static void testEndpoints()
+{
+  DeflateParams params;
+
+  params.enabled = true;
+
+  auto network  = std::make_shared<LoopbackNetwork>();
+  auto toServer = std::make_shared<LoopbackPipe>();
+  auto toClient = std::make_shared<LoopbackPipe>();
+
+  WebsocketsEndpoint client(std::make_shared<LoopbackTcpClient>(network, toClient, toServer));
+  WebsocketsEndpoint server(std::make_shared<LoopbackTcpClient>(network, toServer, toClient));
+
+  client.setDeflate(params, false);
+  server.setDeflate(params, true);
+  server.setUseMasking(false);
+
+  for (size_t length : { 10, 1000, 20000 })
+  {
+    const std::string message = sample(length, 7);
+
+    WS_CHECK(client.send(message.data(), message.size(), ContentType::Text, true));
+
+    WebsocketsMessage received = server.recv();
+
+    WS_CHECK(received.isText());
+    WS_CHECK(received.rawData() == message);
+
+    WS_CHECK(server.send(message.data(), message.size(), ContentType::Binary, true));
+
+    received = client.recv();
+
+    WS_CHECK(received.isBinary());
+    WS_CHECK(received.rawData() == message);
+  }
+}
+
+int main()
+{
+  testNegotiation();
+  testRfcExamples();
+  testRoundTrip();
+  testBadData();
+  testBomb();
+  testEndpoints();
+
+  return wsTestResult("deflate_test");
+}
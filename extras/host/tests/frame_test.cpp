@@ -0,0 +1,258 @@
+/****************************************************************************************************************************
+  frame_test.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+/****************************************************************************************************************************
+  Frame codec: two endpoints joined by loopback pipes send each other every length encoding, masked and not,
+  fragmented and whole, and the parser is fed the raw frames of RFC 6455 section 5.7 and a few malformed ones.
+  Each case runs with whole reads and with reads split into small pseudo random pieces.
+ *****************************************************************************************************************************/
+
+#include <WebSockets2_Generic.h>
+#include <Tiny_Websockets_Generic/internals/websockets_endpoint.hpp>
+#include <Tiny_Websockets_Generic/network/loopback/loopback_tcp.hpp>
+
+#include "ws_test.hpp"
+
+using namespace websockets2_generic;
+using namespace websockets2_generic::internals2_generic;
+using namespace websockets2_generic::network2_generic;
+
+// Larger messages are refused when the build caps them (static strings profile)
+#ifdef _WS_CONFIG_MAX_MESSAGE_SIZE
+  #define LARGEST_MESSAGE   _WS_CONFIG_MAX_MESSAGE_SIZE
+#else
+  #define LARGEST_MESSAGE   ((size_t) -1)
+#endif
+
+// Both ends of a connection, without a handshake
+struct EndpointPair
+{
+  std::shared_ptr<LoopbackPipe>   toServer  = std::make_shared<LoopbackPipe>();
+  std::shared_ptr<LoopbackPipe>   toClient  = std::make_shared<LoopbackPipe>();
+  WebsocketsEndpoint              client;
+  WebsocketsEndpoint              server;
+
+  explicit EndpointPair(std::shared_ptr<LoopbackNetwork> network)
+    : client(std::make_shared<LoopbackTcpClient>(network, toClient, toServer)),
+      server(std::make_shared<LoopbackTcpClient>(network, toServer, toClient))
+  {
+    // Clients mask what they send, servers don't
+    this->server.setUseMasking(false);
+  }
+
+  // Raw bytes, as if the client had sent them
+  void inject(const WSString& bytes)
+  {
+    this->toServer->write(reinterpret_cast<const uint8_t*>(bytes.data()), static_cast<uint32_t>(bytes.size()));
+  }
+};
+
+static WSString pattern(const size_t length)
+{
+  WSString text(length, '\0');
+
+  for (size_t i = 0; i < length; i++)
+  {
+    text[i] = (char) ('a' + i % 26);
+  }
+
+  return text;
+}
+
+// Fragments are gathered by recv(), which returns an empty message until one is complete
+static WebsocketsMessage nextMessage(WebsocketsEndpoint& endpoint)
+{
+  for (int i = 0; i < 16; i++)
+  {
+    WebsocketsMessage message = endpoint.recv();
+
+    if (!message.isEmpty())
+      return message;
+  }
+
+  return WebsocketsMessage();
+}
+
+static void testLengths(std::shared_ptr<LoopbackNetwork> network)
+{
+  EndpointPair pair(network);
+
+  // 7-bit, 16-bit and 64-bit length encodings and their boundaries
+  const size_t lengths[] = { 0, 1, 125, 126, 127, 1000, 65535, 65536, 70000 };
+
+  for (size_t length : lengths)
+  {
+    if (length > LARGEST_MESSAGE)
+      break;
+
+    const WSString payload = pattern(length);
+
+    WS_CHECK(pair.client.send(payload.data(), payload.size(), ContentType::Text, true, true, "\x11\x22\x33\x44"));
+
+    WebsocketsMessage text = nextMessage(pair.server);
+
+    WS_CHECK(text.isText());
+    WS_CHECK(text.rawData() == payload);
+
+    WS_CHECK(pair.server.send(payload.data(), payload.size(), ContentType::Binary, true, false));
+
+    WebsocketsMessage binary = nextMessage(pair.client);
+
+    WS_CHECK(binary.isBinary());
+    WS_CHECK(binary.rawData() == payload);
+  }
+}
+
+static void testFragments(std::shared_ptr<LoopbackNetwork> network)
+{
+  EndpointPair pair(network);
+
+  WS_CHECK(pair.client.send("Hel", 3, ContentType::Text, false, true));
+  // A control frame may come in between the fragments
+  WS_CHECK(pair.client.ping("ping"));
+  WS_CHECK(pair.client.send("lo", 2, ContentType::Continuation, true, true));
+
+  WebsocketsMessage ping = nextMessage(pair.server);
+
+  WS_CHECK(ping.isPing());
+  WS_CHECK(ping.rawData() == "ping");
+
+  WebsocketsMessage message = nextMessage(pair.server);
+
+  WS_CHECK(message.isText());
+  WS_CHECK(message.isComplete());
+  WS_CHECK(message.rawData() == "Hello");
+
+  // The server answered the ping on its own
+  WebsocketsMessage pong = nextMessage(pair.client);
+
+  WS_CHECK(pong.isPong());
+  WS_CHECK(pong.rawData() == "ping");
+}
+
+static void testRfcFrames(std::shared_ptr<LoopbackNetwork> network)
+{
+  EndpointPair pair(network);
+
+  // Single-frame unmasked and masked text messages
+  pair.inject(WSString("\x81\x05\x48\x65\x6c\x6c\x6f", 7));
+  pair.inject(WSString("\x81\x85\x37\xfa\x21\x3d\x7f\x9f\x4d\x51\x58", 11));
+  // A fragmented unmasked text message
+  pair.inject(WSString("\x01\x03\x48\x65\x6c", 5));
+  pair.inject(WSString("\x80\x02\x6c\x6f", 4));
+  // 256 bytes and 64 KiB binary messages, 16-bit and 64-bit lengths
+  pair.inject(WSString("\x82\x7e\x01\x00", 4) + WSString(256, 'x'));
+
+  if (65536 <= LARGEST_MESSAGE)
+    pair.inject(WSString("\x82\x7f\x00\x00\x00\x00\x00\x01\x00\x00", 10) + WSString(65536, 'y'));
+
+  for (int i = 0; i < 3; i++)
+  {
+    WebsocketsMessage message = nextMessage(pair.server);
+
+    WS_CHECK(message.isText());
+    WS_CHECK(message.rawData() == "Hello");
+  }
+
+  WebsocketsMessage small = nextMessage(pair.server);
+
+  WS_CHECK(small.isBinary());
+  WS_CHECK(small.rawData() == WSString(256, 'x'));
+
+  if (65536 <= LARGEST_MESSAGE)
+  {
+    WebsocketsMessage large = nextMessage(pair.server);
+
+    WS_CHECK(large.isBinary());
+    WS_CHECK(large.rawData() == WSString(65536, 'y'));
+  }
+}
+
+static void testProtocolErrors(std::shared_ptr<LoopbackNetwork> network)
+{
+  const WSString malformed[] =
+  {
+    // Reserved bit set, nothing negotiated
+    WSString("\xc1\x05Hello", 7),
+    // Continuation with nothing to continue
+    WSString("\x80\x05Hello", 7),
+    // A new message in the middle of a fragmented one
+    WSString("\x01\x03Hel\x81\x02lo", 9),
+  };
+
+  for (const WSString& frame : malformed)
+  {
+    EndpointPair pair(network);
+
+    pair.inject(frame);
+
+    WebsocketsMessage message = nextMessage(pair.server);
+
+    WS_CHECK(message.isEmpty());
+    WS_CHECK(pair.server.getCloseReason() == CloseReason_ProtocolError);
+  }
+}
+
+static void testRecvInto(std::shared_ptr<LoopbackNetwork> network)
+{
+  EndpointPair pair(network);
+  char buffer[64];
+
+  WS_CHECK(pair.client.send("abc", 3, ContentType::Binary, true, true));
+
+  WebsocketsPayloadInfo info = pair.server.recvInto(buffer, sizeof(buffer));
+
+  WS_CHECK(info.type == MessageType::Binary);
+  WS_CHECK(info.role == MessageRole::Complete);
+  WS_CHECK(info.length == 3);
+  WS_CHECK(WSString(buffer, 3) == "abc");
+
+  // Larger than the caller's buffer
+  const WSString payload = pattern(sizeof(buffer) + 1);
+
+  WS_CHECK(pair.client.send(payload.data(), payload.size(), ContentType::Binary, true, true));
+
+  info = pair.server.recvInto(buffer, sizeof(buffer));
+
+  WS_CHECK(info.isEmpty());
+  WS_CHECK(pair.server.getCloseReason() == CloseReason_MessageTooBig);
+}
+
+int main()
+{
+  const uint32_t chunking[][2] = { { 0, 0 }, { 1, 0 }, { 7, 1 }, { 300, 2 } };
+
+  for (auto& chunks : chunking)
+  {
+    auto network = std::make_shared<LoopbackNetwork>();
+
+    network->setChunking(chunks[0], chunks[1]);
+
+    testLengths(network);
+    testFragments(network);
+    testRfcFrames(network);
+    testProtocolErrors(network);
+    testRecvInto(network);
+  }
+
+  return wsTestResult("frame_test");
+}
@@ -0,0 +1,262 @@
+/****************************************************************************************************************************
+  handshake_test.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+/****************************************************************************************************************************
+  Opening handshake: the accept key of RFC 6455, the incremental request / response parsers fed in pieces of
+  every size, and a complete client / server upgrade over the loopback transport.
+ *****************************************************************************************************************************/
+
+#include <WebSockets2_Generic.h>
+#include <Tiny_Websockets_Generic/internals/ws_handshake.hpp>
+#include <Tiny_Websockets_Generic/internals/wscrypto/crypto.hpp>
+#include <Tiny_Websockets_Generic/network/loopback/loopback_tcp.hpp>
+
+#include "ws_test.hpp"
+
+#include <string>
+
+using namespace websockets2_generic;
+using namespace websockets2_generic::internals2_generic;
+using namespace websockets2_generic::network2_generic;
+
+#define LOOPBACK_PORT     80
+
+static const std::string REQUEST =
+  "GET /chat HTTP/1.1\r\n"
+  "HOST: server.example.com\r\n"
+  "upgrade:   WebSocket  \r\n"
+  "CONNECTION: keep-alive, Upgrade\r\n"
+  "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+  "X-A-Header-Name-Longer-Than-Any-We-Look-For: 1\r\n"
+  "sec-websocket-version:13\r\n"
+  "Sec-WebSocket-Extensions: permessage-deflate; Client_Max_Window_Bits\r\n"
+  "Sec-WebSocket-Extensions: foo\r\n"
+  "\r\n";
+
+static const std::string RESPONSE =
+  "HTTP/1.1 101 Switching Protocols\r\n"
+  "Upgrade: websocket\r\n"
+  "Connection: Upgrade\r\n"
+  "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"
+  "\r\n";
+
+// Feeds `text` followed by a websocket frame in pieces of `step` bytes, returns where the headers ended
+template <class Parser>
+static HandshakeParser::Result feedInSteps(Parser& parser, const std::string& text, const size_t step, size_t& end)
+{
+  HandshakeParser::Result result = HandshakeParser::Result_NeedMore;
+  end = 0;
+
+  while (end < text.size() && result == HandshakeParser::Result_NeedMore)
+  {
+    size_t length   = (text.size() - end < step) ? text.size() - end : step;
+    size_t consumed = 0;
+
+    result = parser.feed(text.data() + end, length, consumed);
+    end += consumed;
+  }
+
+  return result;
+}
+
+static void testAcceptKey()
+{
+  WS_CHECK(crypto2_generic::websocketsHandshakeEncodeKey("dGhlIHNhbXBsZSBub25jZQ==") == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+
+  char accept[30];
+
+  crypto2_generic::websocketsHandshakeEncodeKey("dGhlIHNhbXBsZSBub25jZQ==", accept);
+  WS_CHECK(std::string(accept) == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+static void testRequestParser()
+{
+  const std::string stream = REQUEST + "\x81\x00";
+
+  for (size_t step = 1; step <= stream.size(); step++)
+  {
+    HandshakeRequestParser parser;
+    size_t end;
+
+    WS_CHECK(feedInSteps(parser, stream, step, end) == HandshakeParser::Result_Complete);
+    WS_CHECK(end == REQUEST.size());
+    WS_CHECK(parser.isConnectionUpgrade());
+    WS_CHECK(parser.isUpgradeWebsocket());
+    WS_CHECK(parser.isVersion13());
+    WS_CHECK(std::string(parser.key()) == "dGhlIHNhbXBsZSBub25jZQ==");
+    WS_CHECK(std::string(parser.extensions()) == "permessage-deflate; client_max_window_bits, foo");
+  }
+
+  HandshakeRequestParser parser;
+  size_t end;
+
+  const std::string plain = "GET / HTTP/1.1\r\nConnection: close\r\nUpgrade: h2c\r\nSec-WebSocket-Version: 8\r\n"
+                            "Sec-WebSocket-Key: " + std::string(40, 'A') + "\r\n\r\n";
+
+  WS_CHECK(feedInSteps(parser, plain, plain.size(), end) == HandshakeParser::Result_Complete);
+  WS_CHECK(!parser.isConnectionUpgrade());
+  WS_CHECK(!parser.isUpgradeWebsocket());
+  WS_CHECK(!parser.isVersion13());
+  WS_CHECK(parser.key()[0] == '\0');
+
+  // Extensions that don't fit are refused, not cut
+  const std::string offer = "Sec-WebSocket-Extensions: permessage-deflate; client_max_window_bits\r\n";
+  std::string longOffers  = "GET / HTTP/1.1\r\n";
+
+  while (longOffers.size() < _WS_HANDSHAKE_MAX_SIZE / 2)
+    longOffers += offer;
+
+  parser.reset();
+  WS_CHECK(feedInSteps(parser, longOffers + "\r\n", 7, end) == HandshakeParser::Result_Error);
+
+  // Headers that never end
+  parser.reset();
+  WS_CHECK(feedInSteps(parser, std::string(4096, 'a'), 4096, end) == HandshakeParser::Result_Error);
+}
+
+static void testResponseParser()
+{
+  for (size_t step = 1; step <= RESPONSE.size(); step++)
+  {
+    HandshakeResponseParser parser;
+    size_t end;
+
+    WS_CHECK(feedInSteps(parser, RESPONSE, step, end) == HandshakeParser::Result_Complete);
+    WS_CHECK(end == RESPONSE.size());
+    WS_CHECK(parser.isSwitchingProtocols());
+    WS_CHECK(parser.isConnectionUpgrade());
+    WS_CHECK(parser.isUpgradeWebsocket());
+    WS_CHECK(std::string(parser.accept()) == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+  }
+
+  HandshakeResponseParser parser;
+  size_t end;
+  const std::string refused = "HTTP/1.1 400 Bad Request\r\n\r\n";
+
+  WS_CHECK(feedInSteps(parser, refused, refused.size(), end) == HandshakeParser::Result_Complete);
+  WS_CHECK(!parser.isSwitchingProtocols());
+}
+
+static void testLoopbackUpgrade()
+{
+  auto network = std::make_shared<LoopbackNetwork>();
+
+  // One byte at a time, so both ends see their handshake in pieces
+  network->setChunking(1);
+
+  WebsocketsServer server(new LoopbackTcpServer(network));
+  WebsocketsClient client(std::make_shared<LoopbackTcpClient>(network));
+
+  int connections = 0;
+  WSString received;
+
+  server.onConnection([&](WebsocketsClient&)
+  {
+    connections++;
+  });
+
+  server.onMessage([](WebsocketsClient& peer, WebsocketsMessage message)
+  {
+    peer.send(message.c_str(), message.length());
+  });
+
+  client.onMessage([&](WebsocketsClient&, WebsocketsMessage message)
+  {
+    received = message.rawData();
+  });
+
+  server.listen(LOOPBACK_PORT);
+  client.connectAsync("loopback", LOOPBACK_PORT, "/chat");
+
+  for (int i = 0; i < 10000 && client.isConnecting(); i++)
+  {
+    server.poll();
+    client.poll();
+  }
+
+  WS_CHECK(client.available());
+  WS_CHECK(connections == 1);
+
+  client.send("hello");
+
+  for (int i = 0; i < 10000 && received.empty(); i++)
+  {
+    server.poll();
+    client.poll();
+  }
+
+  WS_CHECK(received == "hello");
+
+  client.close();
+  server.poll();
+}
+
+// A request that isn't a websocket upgrade is answered with 400 before the connection is closed
+static void testLoopbackRejected()
+{
+  auto network = std::make_shared<LoopbackNetwork>();
+
+  WebsocketsServer server(new LoopbackTcpServer(network));
+  LoopbackTcpClient raw(network);
+  int connections = 0;
+
+  server.onConnection([&](WebsocketsClient&)
+  {
+    connections++;
+  });
+
+  server.listen(LOOPBACK_PORT);
+  WS_CHECK(raw.connect("loopback", LOOPBACK_PORT));
+
+  const std::string request = "GET / HTTP/1.1\r\nHost: x\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+
+  WS_CHECK(raw.send(reinterpret_cast<const uint8_t*>(request.data()), static_cast<uint32_t>(request.size())));
+
+  for (int i = 0; i < 10; i++)
+  {
+    server.poll();
+  }
+
+  std::string response;
+  uint8_t     buffer[128];
+  uint32_t    numRead;
+
+  while (raw.poll() && (numRead = raw.read(buffer, sizeof(buffer))) > 0 && numRead != static_cast<uint32_t>(-1))
+  {
+    response.append(reinterpret_cast<const char*>(buffer), numRead);
+  }
+
+  WS_CHECK(response.compare(0, 25, "HTTP/1.1 400 Bad Request\r") == 0);
+  WS_CHECK(connections == 0);
+  WS_CHECK(server.getConnectionsCount() == 0);
+}
+
+int main()
+{
+  testAcceptKey();
+  testRequestParser();
+  testResponseParser();
+  testLoopbackUpgrade();
+  testLoopbackRejected();
+
+  return wsTestResult("handshake_test");
+}
@@ -0,0 +1,93 @@
+/****************************************************************************************************************************
+  mask_test.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+/****************************************************************************************************************************
+  maskPayload() against a byte at a time reference, for every length up to a few vector widths, every key
+  offset and every source / destination misalignment, in place and out of place.
+ *****************************************************************************************************************************/
+
+#include <Tiny_Websockets_Generic/internals/ws_mask.hpp>
+
+#include "ws_test.hpp"
+
+#include <string.h>
+
+using namespace websockets2_generic::internals2_generic;
+
+#define MAX_LENGTH    80
+
+static void referenceMask(uint8_t* dst, const uint8_t* src, size_t len, const uint8_t* key, size_t offset)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    dst[i] = src[i] ^ key[(offset + i) & 3];
+  }
+}
+
+int main()
+{
+  const uint8_t key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+
+  // RFC 6455 section 5.7, a masked "Hello"
+  const uint8_t hello[]   = { 'H', 'e', 'l', 'l', 'o' };
+  const uint8_t masked[]  = { 0x7f, 0x9f, 0x4d, 0x51, 0x58 };
+  uint8_t       out[5];
+
+  maskPayload(out, hello, sizeof(hello), key);
+  WS_CHECK(memcmp(out, masked, sizeof(masked)) == 0);
+
+  uint8_t source[MAX_LENGTH + 16];
+  uint8_t expected[MAX_LENGTH + 16];
+  uint8_t actual[MAX_LENGTH + 16];
+
+  for (size_t i = 0; i < sizeof(source); i++)
+  {
+    source[i] = (uint8_t) (i * 31 + 7);
+  }
+
+  for (size_t len = 0; len <= MAX_LENGTH; len++)
+  {
+    for (size_t offset = 0; offset < 4; offset++)
+    {
+      for (size_t srcShift = 0; srcShift < 8; srcShift++)
+      {
+        for (size_t dstShift = 0; dstShift < 8; dstShift++)
+        {
+          memset(actual, 0xaa, sizeof(actual));
+          referenceMask(expected, source + srcShift, len, key, offset);
+          maskPayload(actual + dstShift, source + srcShift, len, key, offset);
+
+          WS_CHECK(memcmp(actual + dstShift, expected, len) == 0);
+          // Nothing written past the end
+          WS_CHECK(actual[dstShift + len] == 0xaa);
+        }
+
+        // In place
+        memcpy(actual + srcShift, source + srcShift, len);
+        maskPayload(actual + srcShift, actual + srcShift, len, key, offset);
+        WS_CHECK(memcmp(actual + srcShift, expected, len) == 0);
+      }
+    }
+  }
+
+  return wsTestResult("mask_test");
+}
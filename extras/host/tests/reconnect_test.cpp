@@ -0,0 +1,80 @@
+/****************************************************************************************************************************
+  reconnect_test.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+/****************************************************************************************************************************
+  Reconnection: a client left with no server keeps retrying on its own schedule, whatever its policy.
+ *****************************************************************************************************************************/
+
+#include <WebSockets2_Generic.h>
+#include <Tiny_Websockets_Generic/network/loopback/loopback_tcp.hpp>
+
+#include "ws_test.hpp"
+
+using namespace websockets2_generic;
+using namespace websockets2_generic::network2_generic;
+
+#define LOOPBACK_PORT     80
+
+// A jitter over 100% is clamped: the random offset could otherwise exceed the delay and wrap it into an
+// almost endless wait. With 100ms delays, retries must keep coming
+static void testJitterClamped()
+{
+  // Nothing listens on this network, every attempt fails at once
+  WebsocketsClient client(std::make_shared<LoopbackTcpClient>(std::make_shared<LoopbackNetwork>()));
+
+  int failures = 0;
+
+  client.onEvent([&](WebsocketsClient&, WebsocketsEvent event, WSInterfaceString)
+  {
+    if (event == WebsocketsEvent::ConnectionFailed)
+      failures++;
+  });
+
+  ReconnectPolicy policy;
+  policy.minDelay     = 100;
+  policy.maxDelay     = 100;
+  policy.jitter       = 255;
+  policy.minInterval  = 0;
+
+  client.setReconnect(policy);
+
+  WS_CHECK(!client.connectAsync("loopback", LOOPBACK_PORT, "/"));
+  WS_CHECK(failures == 1);
+
+  // At most 200ms apart once clamped
+  unsigned long start = millis();
+
+  while (failures < 8 && millis() - start < 3000)
+  {
+    client.poll();
+    delay(1);
+  }
+
+  WS_CHECK(failures >= 8);
+}
+
+int main()
+{
+  testJitterClamped();
+
+  return wsTestResult("reconnect_test");
+}
@@ -29,6 +29,7 @@
 #include <Tiny_Websockets_Generic/network/tcp_client.hpp>
 #include <Tiny_Websockets_Generic/internals/data_frame.hpp>
 #include <Tiny_Websockets_Generic/internals/websockets_endpoint.hpp>
+#include <Tiny_Websockets_Generic/internals/ws_handshake.hpp>
 #include <Tiny_Websockets_Generic/message.hpp>
 #include <memory>
 #include <functional>
@@ -73,6 +74,9 @@
 #elif WEBSOCKETS_USE_PORTENTA_H7_WIFI
   #warning WEBSOCKETS_USE_PORTENTA_H7_WIFI in client.hpp
   #include <Tiny_Websockets_Generic/internals/ws_common_WiFi_Portenta_H7.hpp> 
+#elif defined(__linux__)
+  // Host build, Linux sockets
+  #include <Tiny_Websockets_Generic/internals/ws_common.hpp>
 #else
   #warning WEBSOCKETS_USE_ESP_WIFI in client.hpp
   #include <Tiny_Websockets_Generic/internals/ws_common.hpp>  
@@ -87,16 +91,42 @@ namespace websockets2_generic
   {
     ConnectionOpened,
     ConnectionClosed,
-    GotPing, GotPong
+    GotPing, GotPong,
+    ConnectionFailed        // connectAsync() gave up, the data tells why (see getConnectFailReason())
+  };
+  
+  enum ConnectFailReason 
+  {
+    ConnectFailReason_None,
+    ConnectFailReason_TcpConnect,       // host not resolved or not reachable
+    ConnectFailReason_Closed,           // dropped by the server during the handshake
+    ConnectFailReason_BadResponse,      // not a valid 101 Switching Protocols
+    ConnectFailReason_Timeout           // no complete response within _WS_CONNECT_TIMEOUT
+  };
+  
+  // How WebsocketsClient::setReconnect() retries. The n-th retry waits minDelay * 2^(n-1), capped at maxDelay,
+  // then moved by a random +/- jitter percent so that many devices dropped at once don't come back at once
+  struct ReconnectPolicy 
+  {
+    uint32_t  minDelay    = _WS_RECONNECT_MIN_DELAY;
+    uint32_t  maxDelay    = _WS_RECONNECT_MAX_DELAY;
+    uint8_t   jitter      = _WS_RECONNECT_JITTER;           // percent, at most 100
+    uint32_t  minInterval = _WS_RECONNECT_MIN_INTERVAL;     // between two attempts, whatever the delay
   };
   
   class WebsocketsClient;
+  
+  // The message is moved into the callback, which may as well take it as `WebsocketsMessage&&` or
+  // `const WebsocketsMessage&`
   typedef std::function<void(WebsocketsClient&, WebsocketsMessage)> MessageCallback;
   typedef std::function<void(WebsocketsMessage)> PartialMessageCallback;
   
   typedef std::function<void(WebsocketsClient&, WebsocketsEvent, WSInterfaceString)> EventCallback;
   typedef std::function<void(WebsocketsEvent, WSInterfaceString)> PartialEventCallback;
   
+  typedef std::function<void(WebsocketsClient&, const WebsocketsPayloadChunk&)> PayloadChunkCallback;
+  typedef std::function<void(const WebsocketsPayloadChunk&)> PartialPayloadChunkCallback;
+  
   class WebsocketsClient 
   {
     public:
@@ -114,12 +144,40 @@ namespace websockets2_generic
       bool connect(const WSInterfaceString url);
       bool connect(const WSInterfaceString host, const int port, const WSInterfaceString path);
       bool connectSecure(const WSInterfaceString host, const int port, const WSInterfaceString path);
+      
+      // Return right away: resolving, TCP connect, sending the upgrade request and reading the response all
+      // happen in poll(), which fires ConnectionOpened or ConnectionFailed when done. connect() does the same,
+      // but waits for the outcome. Returns false if the connection could not even be started
+      bool connectAsync(const WSInterfaceString url);
+      bool connectAsync(const WSInterfaceString host, const int port, const WSInterfaceString path);
+      
+      bool isConnecting() const 
+      {
+        return this->_connectState.stage != ConnectStage_Idle;
+      }
+      
+      ConnectFailReason getConnectFailReason() const 
+      {
+        return this->_connectFailReason;
+      }
+      
+      // Once connect() / connectAsync() was called, poll() reconnects by itself when the connection drops or
+      // an attempt fails, reusing the request already rendered and the server's last address. Each attempt
+      // fires ConnectionOpened or ConnectionFailed. close() stops it until the next connect()
+      void setReconnect(const ReconnectPolicy& policy = ReconnectPolicy());
+      void disableReconnect();
   
       void onMessage(const MessageCallback callback);
       void onMessage(const PartialMessageCallback callback);
   
       void onEvent(const EventCallback callback);
       void onEvent(const PartialEventCallback callback);
+      
+      // Streams Text / Binary payloads to `callback` as they arrive, instead of buffering whole messages
+      // for onMessage(). Lets messages larger than free RAM be processed with constant memory.
+      // Pass an empty PayloadChunkCallback() to go back to onMessage()
+      void onPayloadChunk(const PayloadChunkCallback callback);
+      void onPayloadChunk(const PartialPayloadChunkCallback callback);
   
       bool poll();
       bool available(const bool activeTest = false);
@@ -129,13 +187,16 @@ namespace websockets2_generic
       bool send(const char* data);
       bool send(const char* data, const size_t len);
   
-      bool sendBinary(const WSInterfaceString data);
+      bool sendBinary(const WSInterfaceString& data);
       bool sendBinary(const char* data, const size_t len);
   
       // stream messages
-      bool stream(const WSInterfaceString data = "");
-      bool streamBinary(const WSInterfaceString data = "");
-      bool end(const WSInterfaceString data = "");
+      bool stream(const WSInterfaceString& data = "");
+      bool stream(const char* data, const size_t len);
+      bool streamBinary(const WSInterfaceString& data = "");
+      bool streamBinary(const char* data, const size_t len);
+      bool end(const WSInterfaceString& data = "");
+      bool end(const char* data, const size_t len);
   
       void setFragmentsPolicy(const FragmentsPolicy newPolicy);
       FragmentsPolicy getFragmentsPolicy() const;
@@ -145,9 +206,15 @@ namespace websockets2_generic
       //////
       
       WebsocketsMessage readBlocking();
+      
+      // Reads the next frame directly into `buffer`, without allocating. Non-blocking, like readNonBlocking()
+      WebsocketsPayloadInfo readInto(char* buffer, const size_t capacity);
   
-      bool ping(const WSInterfaceString data = "");
-      bool pong(const WSInterfaceString data = "");
+      // The (data, len) overloads send straight from the caller's buffer, the others without converting the string either
+      bool ping(const WSInterfaceString& data = "");
+      bool ping(const char* data, const size_t len);
+      bool pong(const WSInterfaceString& data = "");
+      bool pong(const char* data, const size_t len);
   
       void close(const CloseReason reason = CloseReason_NormalClosure);
       CloseReason getCloseReason() const;
@@ -156,6 +223,31 @@ namespace websockets2_generic
       {
         _endpoint.setUseMasking(useMasking);
       }
+      
+      // A copy of the connection's counters (see WebsocketsStats), cheap enough to take every poll
+      WebsocketsStats getStats() const 
+      {
+        return _endpoint.stats();
+      }
+      
+      void resetStats() 
+      {
+        _endpoint.stats() = WebsocketsStats();
+      }
+      
+  #ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+      // True if permessage-deflate was agreed on for the current connection
+      bool isCompressionEnabled() const 
+      {
+        return _endpoint.isDeflateEnabled();
+      }
+      
+      // Messages shorter than `threshold` bytes are sent uncompressed (default _WS_DEFLATE_THRESHOLD)
+      void setCompressionThreshold(const size_t threshold) 
+      {
+        _endpoint.setDeflateThreshold(threshold);
+      }
+  #endif
   
       void setInsecure();
   #ifdef ESP8266
@@ -174,6 +266,9 @@ namespace websockets2_generic
   
       virtual ~WebsocketsClient();
       
+      // The server sets up the endpoint of the clients it accepts
+      friend class WebsocketsServer;
+      
       // KH add
       void setAuthorization(const char * user, const char * password);
       WSString getAuthorization(void);
@@ -190,11 +285,55 @@ namespace websockets2_generic
       bool _connectionOpen;
       MessageCallback _messagesCallback;
       EventCallback _eventsCallback;
+      PayloadChunkCallback _payloadChunkCallback;
       enum SendMode 
       {
         SendMode_Normal,
         SendMode_Streaming
       } _sendMode;
+      
+      enum ConnectStage 
+      {
+        ConnectStage_Idle,
+        ConnectStage_TcpConnect,
+        ConnectStage_Response
+      };
+      
+      // Progress of connectAsync()
+      struct ConnectState 
+      {
+        ConnectStage  stage         = ConnectStage_Idle;
+        unsigned long startedAt     = 0;
+        bool          usingAddress  = false;  // connecting to _target.address instead of the host name
+        internals2_generic::HandshakeResponseParser response;
+      } _connectState;
+      
+      ConnectFailReason _connectFailReason = ConnectFailReason_None;
+      
+      // What connect() / connectAsync() was last given, kept for reconnects
+      struct ConnectTarget 
+      {
+        WSString  host;
+        int       port = 0;
+        WSString  path;
+        WSString  address;                    // last address of the server, if the transport knows it
+        WSString  request;                    // rendered upgrade request, see renderHandshake()
+        size_t    keyOffset = 0;              // of the Sec-WebSocket-Key value in it
+        WSString  expectedAcceptKey;
+      } _target;
+      
+      struct ReconnectState 
+      {
+        ReconnectPolicy policy;
+        bool            enabled       = false;
+        bool            armed         = false;    // by connect(), an application close() disarms it
+        bool            scheduled     = false;
+        uint8_t         attempts      = 0;        // since the connection was last open
+        unsigned long   scheduledAt   = 0;
+        uint32_t        delay         = 0;
+        bool            attempted     = false;
+        unsigned long   lastAttemptAt = 0;
+      } _reconnect;
   
   
   #ifdef ESP8266
@@ -217,8 +356,25 @@ namespace websockets2_generic
       void _handlePing(WebsocketsMessage);
       void _handlePong(WebsocketsMessage);
       void _handleClose(WebsocketsMessage);
+      void _bindPayloadSink();
+      
+      // Handles at most `maxMessages` messages
+      bool _poll(const size_t maxMessages);
+      bool _pollMessages(const size_t maxMessages);
+      
+      // Counts a send refused by the client itself, returns false
+      bool _sendFailed();
       
       void upgradeToSecuredConnection();
+      
+      bool parseUrl(const WSInterfaceString url, WSString& host, int& port, WSString& path);
+      bool beginConnect();
+      void renderHandshake();
+      bool advanceConnect();
+      void advanceReconnect();
+      uint32_t reconnectDelay();
+      bool finishConnect();
+      bool failConnect(const ConnectFailReason reason, const char* description);
   };
 }   // namespace websockets2_generic 
 
@@ -85,49 +85,5 @@ namespace websockets2_generic
         return (fin == 1) && (opcode != 0);
       }
     };
-    
-    template <class HeaderTy> HeaderTy MakeHeader(size_t len, uint8_t opcode, bool fin, bool mask) 
-    {
-      HeaderTy header;
-      header.fin = fin;
-      header.flags = 0;
-      header.opcode = opcode;
-      header.mask = mask ? 1 : 0;
-    
-      // set payload
-      if (len < 126) 
-      {
-        header.payload = len;
-      } 
-      else if (len < 65536) 
-      {
-        header.payload = 126;
-      } 
-      else 
-      {
-        header.payload = 127;
-      }
-    
-      return header;
-    }
-    
-    struct Header 
-    {
-      uint8_t opcode : 4;
-      uint8_t flags : 3;
-      uint8_t fin : 1;
-      uint8_t payload : 7;
-      uint8_t mask : 1;
-    };
-    
-    struct HeaderWithExtended16 : Header 
-    {      
-      uint16_t extendedPayload;
-    };
-    
-    struct HeaderWithExtended64 : Header 
-    {
-      uint64_t extendedPayload;
-    };
   }     // namespace internals2_generic
 }       // namespace websockets2_generic
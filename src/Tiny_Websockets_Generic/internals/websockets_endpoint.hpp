@@ -26,8 +26,11 @@
 #include <Tiny_Websockets_Generic/internals/ws_common.hpp>
 #include <Tiny_Websockets_Generic/network/tcp_client.hpp>
 #include <Tiny_Websockets_Generic/internals/data_frame.hpp>
+#include <Tiny_Websockets_Generic/internals/ws_mask.hpp>
+#include <Tiny_Websockets_Generic/internals/ws_deflate.hpp>
 #include <Tiny_Websockets_Generic/message.hpp>
 #include <memory>
+#include <functional>
 
 #define __TINY_WS_INTERNAL_DEFAULT_MASK "\00\00\00\00"
 
@@ -56,8 +59,96 @@ namespace websockets2_generic
   
   CloseReason GetCloseReason(uint16_t reasonCode);
   
+  // Traffic counters of a connection, see WebsocketsClient::getStats(). They add up across reconnects
+  // until resetStats()
+  struct WebsocketsStats 
+  {
+    // framesIn / framesOut slots, by opcode
+    enum Frame 
+    {
+      Frame_Continuation,
+      Frame_Text,
+      Frame_Binary,
+      Frame_Close,
+      Frame_Ping,
+      Frame_Pong,
+      Frame_Count
+    };
+    
+    // Ping round trip histogram: rtt[0] counts the ones under 1 ms, rtt[i] those from 2^(i-1) to 2^i ms,
+    // the last one everything longer
+    static const uint8_t RttBuckets = 12;
+    
+    uint64_t  bytesIn                 = 0;      // frames, headers included
+    uint64_t  bytesOut                = 0;
+    uint32_t  framesIn[Frame_Count]   = {};
+    uint32_t  framesOut[Frame_Count]  = {};
+    uint32_t  messagesIn              = 0;      // data messages, counted on their final frame
+    uint32_t  messagesOut             = 0;
+    uint32_t  fragmentsIn             = 0;      // frames of fragmented data messages
+    uint32_t  fragmentsOut            = 0;
+    uint32_t  failedSends             = 0;      // refused (not connected, too long, wrong stream mode) or not fully written
+    uint64_t  pollTime                = 0;      // us spent in poll(), callbacks included
+    uint64_t  callbackTime            = 0;      // us spent in the message / event callbacks called by poll()
+    uint32_t  rttLast                 = 0;      // us, of the last ping answered
+    uint32_t  rttMax                  = 0;
+    uint32_t  rtt[RttBuckets]         = {};
+    
+    // Slot of an opcode in framesIn / framesOut, -1 for a reserved one
+    static int8_t frameSlot(const uint8_t opcode) 
+    {
+      if (opcode <= 0x2)
+        return opcode;
+      
+      if (opcode >= 0x8 && opcode <= 0xA)
+        return opcode - 0x8 + Frame_Close;
+      
+      return -1;
+    }
+    
+    void addFrame(const bool in, const uint8_t opcode, const bool fin) 
+    {
+      int8_t slot = frameSlot(opcode);
+      
+      if (slot < 0)
+        return;
+      
+      (in ? this->framesIn : this->framesOut)[slot]++;
+      
+      if (slot <= Frame_Binary) 
+      {
+        if (fin)
+          (in ? this->messagesIn : this->messagesOut)++;
+        
+        if (!fin || slot == Frame_Continuation)
+          (in ? this->fragmentsIn : this->fragmentsOut)++;
+      }
+    }
+    
+    void addRtt(const uint32_t us) 
+    {
+      uint32_t  ms      = us / 1000;
+      uint8_t   bucket  = 0;
+      
+      while (ms > 0 && bucket < RttBuckets - 1) 
+      {
+        ms >>= 1;
+        bucket++;
+      }
+      
+      this->rtt[bucket]++;
+      this->rttLast = us;
+      
+      if (us > this->rttMax)
+        this->rttMax = us;
+    }
+  };
+  
   namespace internals2_generic 
   {
+    // XORs the payload with the frame's masking key, in place (masking and unmasking are the same)
+    void remaskData(WSString& data, const uint8_t* const maskingKey, uint64_t payloadLength);
+    void remaskData(uint8_t* data, const uint8_t* const maskingKey, uint64_t payloadLength);
   
     class WebsocketsEndpoint 
     {
@@ -74,6 +165,23 @@ namespace websockets2_generic
     
         bool poll();
         WebsocketsMessage recv();
+
+        // Reads the next frame, writing its payload straight into `buffer` (no intermediate copies).
+        // Control frames are still handled internally (pong / close). Each fragment of a fragmented
+        // message is returned separately, with its role set accordingly.
+        // Like recv(), this never waits for data: if only part of a frame has arrived, an empty result is
+        // returned and the frame is resumed by the next call, which must pass the same buffer.
+        WebsocketsPayloadInfo recvInto(char* buffer, const size_t capacity);
+        
+        // With a sink set, recv() no longer buffers Text / Binary / Continuation payloads: they are passed
+        // to the sink in pieces of at most _WS_BUFFER_SIZE bytes, already unmasked, as they are read.
+        // Control frames are still handled as usual. An empty sink restores normal buffering
+        void setPayloadSink(const std::function<void(const WebsocketsPayloadChunk&)> sink);
+        
+        // Bytes that came in with the handshake response, parsed before anything read from the socket.
+        // Returns false if they don't fit in the receive buffer
+        bool preloadReceived(const uint8_t* data, const size_t len);
+
         bool send(const char* data, const size_t len, const uint8_t opcode, const bool fin, const bool mask, const char* maskingKey = __TINY_WS_INTERNAL_DEFAULT_MASK);
         bool send(const WSString& data, const uint8_t opcode, const bool fin, const bool mask, const char* maskingKey = __TINY_WS_INTERNAL_DEFAULT_MASK);
     
@@ -82,9 +190,11 @@ namespace websockets2_generic
     
         bool ping(const WSString& msg);
         bool ping(const WSString&& msg);
+        bool ping(const char* data, const size_t len);
     
         bool pong(const WSString& msg);
         bool pong(const WSString&& msg);
+        bool pong(const char* data, const size_t len);
     
         void close(const CloseReason reason = CloseReason_NormalClosure);
         CloseReason getCloseReason() const;
@@ -96,6 +206,25 @@ namespace websockets2_generic
         {
           _useMasking = useMasking;
         }
+        
+        WebsocketsStats& stats() 
+        {
+          return this->_stats;
+        }
+        
+        const WebsocketsStats& stats() const 
+        {
+          return this->_stats;
+        }
+        
+    #ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+        // Turns permessage-deflate on (or off, if !params.enabled) as agreed on in the handshake
+        void setDeflate(const DeflateParams& params, const bool isServer);
+        bool isDeflateEnabled() const;
+        
+        // Messages shorter than this are sent uncompressed. Kept across connections
+        void setDeflateThreshold(const size_t threshold);
+    #endif
     
         virtual ~WebsocketsEndpoint();
         
@@ -113,13 +242,81 @@ namespace websockets2_generic
         CloseReason _closeReason;
         bool _useMasking = true;
     
+        // Type of the fragmented message being received through recvInto()
+        MessageType _recvIntoStreamType = MessageType::Empty;
+        
+        // Incremental frame parser. A frame arriving in pieces is resumed on the next poll(),
+        // instead of blocking the loop or losing the bytes already consumed
+        enum RecvStage 
+        {
+          RecvStage_Header,
+          RecvStage_ExtendedLength,
+          RecvStage_MaskingKey,
+          RecvStage_Payload
+        };
+        
+        struct FrameParser 
+        {
+          RecvStage       stage       = RecvStage_Header;
+          uint8_t         field[8];                 // header, extended length or masking key bytes
+          uint8_t         fieldLength = 2;          // size of the field being read
+          uint8_t         fieldRead   = 0;
+          uint64_t        payloadRead = 0;
+          WebsocketsFrame frame       = WebsocketsFrame();
+          bool            sink        = false;      // payload goes to _payloadSink instead of frame.payload
+          bool            compressed  = false;      // part of a permessage-deflate message
+        } _parser;
+        
+        WebsocketsStats _stats;
+        bool            _pingPending  = false;      // our last ping wasn't answered yet
+        unsigned long   _pingSentAt   = 0;          // micros()
+        
+        std::function<void(const WebsocketsPayloadChunk&)> _payloadSink;
+        MessageType _sinkType   = MessageType::Empty;     // message currently being streamed to the sink
+        uint64_t    _sinkOffset = 0;
+
+    #if (_WS_RX_BUFFER_SIZE > 0)
+        // Bytes read from the socket but not parsed yet. Refilled only once drained,
+        // so the unread part always starts at _rxStart
+        uint8_t   _rxBuffer[_WS_RX_BUFFER_SIZE];
+        uint32_t  _rxStart = 0;
+        uint32_t  _rxCount = 0;
+        
+        uint32_t takeBuffered(uint8_t* buffer, const uint32_t len);
+    #endif
+    
+        uint32_t readSome(uint8_t* buffer, const uint32_t len);
+        void copyReceiveBuffer(const WebsocketsEndpoint& other);
+        void resetParser();
+        bool readField();
+        bool beginPayload(uint8_t* external, const size_t capacity);
+        bool parseFrame(uint8_t* external, const size_t capacity);
+        bool beginSinkFrame();
+        bool readIntoSink();
+        bool checkReservedBits(const uint8_t rsv);
+        
+    #ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+        std::shared_ptr<PerMessageDeflate> _deflate;
+        size_t      _deflateThreshold = _WS_DEFLATE_THRESHOLD;
+        MessageType _inflateType = MessageType::Empty;    // compressed message being received
+        WSString    _inflateInput;                        // and its payload so far
+        
+        bool receiveCompressed(WebsocketsFrame& frame);
+    #endif
+    
+        bool sendFrame(const char* data, const size_t len, const uint8_t opcode, const bool fin, const bool mask, const char* maskingKey, const bool compressed);
+        bool sendMasked(const uint8_t* header, const size_t headerSize, const uint8_t* payload, const size_t len, const uint8_t* maskingKey);
+        bool frameSent(const size_t bytes, const uint8_t opcode, const bool fin);
+        bool sendFailed();
+        
         WebsocketsFrame _recv();
         void handleMessageInternally(WebsocketsMessage& msg);
+        void handleControlInternally(const MessageType type, const char* data, const size_t len);
     
         WebsocketsMessage handleFrameInStreamingMode(WebsocketsFrame& frame);
         WebsocketsMessage handleFrameInStandardMode(WebsocketsFrame& frame);
     
-        std::string getHeader(uint64_t len, uint8_t opcode, bool fin, bool mask);
+        size_t writeHeader(uint8_t* buffer, uint64_t len, uint8_t opcode, bool fin, bool mask, bool compressed = false);
     };    // class WebsocketsEndpoint
   }       // namespace internals2_generic 
 }         // websockets::internals
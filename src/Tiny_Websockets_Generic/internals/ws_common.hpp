@@ -30,9 +30,17 @@
 #include <string>
 #include <Arduino.h>
 
+#ifdef _WS_CONFIG_PAYLOAD_POOL
+  #include <Tiny_Websockets_Generic/internals/ws_pool.hpp>
+#endif
+
 namespace websockets2_generic
 {
+#ifdef _WS_CONFIG_PAYLOAD_POOL
+  typedef std::basic_string<char, std::char_traits<char>, internals2_generic::PoolAllocator<char>> WSString;
+#else
   typedef std::string WSString;
+#endif
   typedef String WSInterfaceString;
   
   namespace internals2_generic
@@ -75,6 +83,22 @@ namespace websockets2_generic
   // OpenSSL Dependent
   #define WSDefaultSecuredTcpClient websockets2_generic::network2_generic::SecuredEsp32TcpClient
   #endif //_WS_CONFIG_NO_SSL
+
+#elif defined(__linux__)
+
+  // Linux host (edge gateways), non-blocking sockets on epoll
+
+  #define PLATFORM_DOES_NOT_SUPPORT_BLOCKING_READ
+  
+  #include <Tiny_Websockets_Generic/network/linux/linux_tcp_client.hpp>
+  #include <Tiny_Websockets_Generic/network/linux/linux_tcp_server.hpp>
+  #define WSDefaultTcpClient websockets2_generic::network2_generic::LinuxTcpClient
+  #define WSDefaultTcpServer websockets2_generic::network2_generic::LinuxTcpServer
+  
+  // No TLS client on Linux yet
+  #ifndef _WS_CONFIG_NO_SSL
+    #define _WS_CONFIG_NO_SSL
+  #endif
       
 #endif    // ESP8266
 
@@ -27,9 +27,17 @@
 #include <string>
 #include <Arduino.h>
 
+#ifdef _WS_CONFIG_PAYLOAD_POOL
+  #include <Tiny_Websockets_Generic/internals/ws_pool.hpp>
+#endif
+
 namespace websockets2_generic
 {
+#ifdef _WS_CONFIG_PAYLOAD_POOL
+  typedef std::basic_string<char, std::char_traits<char>, internals2_generic::PoolAllocator<char>> WSString;
+#else
   typedef std::string WSString;
+#endif
   typedef String WSInterfaceString;
   
   namespace internals2_generic
@@ -0,0 +1,103 @@
+/****************************************************************************************************************************
+  ws_deflate.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#include <Tiny_Websockets_Generic/internals/ws_common.hpp>
+#include <memory>
+
+#ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+
+namespace websockets2_generic
+{
+  namespace internals2_generic
+  {
+    // permessage-deflate parameters (RFC 7692) agreed on during the handshake
+    struct DeflateParams
+    {
+      bool    enabled                 = false;
+      bool    serverNoContextTakeover = false;
+      bool    clientNoContextTakeover = false;
+      uint8_t serverMaxWindowBits     = 15;
+      uint8_t clientMaxWindowBits     = 15;
+    };
+    
+    // Client side: value of the Sec-WebSocket-Extensions request header
+    WSString deflateClientOffer();
+    
+    // Client side: checks the server's Sec-WebSocket-Extensions response header (may be empty).
+    // Returns false if the response is not acceptable, the connection must then be failed
+    bool deflateParseResponse(const char* header, DeflateParams& params);
+    
+    // Server side: accepts the first usable offer of the client's Sec-WebSocket-Extensions header.
+    // `response` gets the value to answer with, left empty if nothing was accepted
+    bool deflateAcceptOffer(const char* header, DeflateParams& params, WSString& response);
+    
+    enum InflateResult
+    {
+      InflateResult_Ok,
+      InflateResult_BadData,
+      InflateResult_TooBig
+    };
+    
+    // Compresses / decompresses whole messages. Outgoing messages never refer to previous ones
+    // (we always behave as with no_context_takeover), so the only memory kept between messages
+    // is the LZ77 hash table and, if the peer uses context takeover, its window of history
+    class PerMessageDeflate
+    {
+      public:
+        PerMessageDeflate(const DeflateParams& params, const bool isServer);
+        
+        // Compresses `data` into `out` (without the trailing 00 00 ff ff). Returns false if the message
+        // wouldn't get any smaller, it should then be sent as is
+        bool compress(const uint8_t* data, const size_t len, WSString& out);
+        
+        // Inflates a received message (RSV1 set, tail already stripped by the sender)
+        InflateResult decompress(const uint8_t* data, const size_t len, WSString& out);
+        
+        // Messages shorter than this are sent uncompressed
+        void setThreshold(const size_t threshold) 
+        {
+          _threshold = threshold;
+        }
+        
+        size_t getThreshold() const 
+        {
+          return _threshold;
+        }
+        
+      private:
+        uint8_t   _sendWindowBits;
+        uint8_t   _recvWindowBits;
+        bool      _recvContextTakeover;
+        size_t    _threshold;
+        
+        // Last bytes of the previous messages, only kept while the peer may refer to them
+        WSString  _history;
+        
+        std::unique_ptr<uint16_t[]> _hashTable;
+    };
+  }   // namespace internals2_generic
+}     // namespace websockets2_generic
+
+#endif    // _WS_CONFIG_PERMESSAGE_DEFLATE
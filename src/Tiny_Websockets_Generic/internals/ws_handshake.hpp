@@ -0,0 +1,192 @@
+/****************************************************************************************************************************
+  ws_handshake.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#include <Tiny_Websockets_Generic/internals/ws_common.hpp>
+
+namespace websockets2_generic
+{
+  namespace internals2_generic
+  {
+    // Parses an upgrade request or its response as it arrives, in one pass over the bytes, without any heap
+    // allocation. Only the headers the handshake needs are kept, in fixed arrays; header names are matched
+    // case-insensitively
+    class HandshakeParser 
+    {
+      public:
+        enum Result 
+        {
+          Result_NeedMore,
+          Result_Complete,
+          Result_Error
+        };
+        
+        void reset();
+        
+        // Consumes `data` up to the end of the header block. `consumed` tells how much of it was used,
+        // whatever follows belongs to the websocket stream. Result_Error once the headers pass
+        // _WS_HANDSHAKE_MAX_SIZE, or the Sec-WebSocket-Extensions ones _WS_HANDSHAKE_EXTENSIONS_SIZE
+        Result feed(const char* data, const size_t len, size_t& consumed);
+        
+        // Bytes consumed so far
+        size_t size() const 
+        {
+          return this->_size;
+        }
+        
+        // Connection: has an `upgrade` token
+        bool isConnectionUpgrade() const 
+        {
+          return this->_connectionUpgrade;
+        }
+        
+        // Upgrade: websocket
+        bool isUpgradeWebsocket() const 
+        {
+          return this->_upgradeWebsocket;
+        }
+        
+        // Sec-WebSocket-Extensions, lowercased. Several headers are joined with ", "
+        const char* extensions() const 
+        {
+          return this->_extensions;
+        }
+        
+      protected:
+        // A response has a status line and a Sec-WebSocket-Accept instead of a Sec-WebSocket-Key
+        explicit HandshakeParser(const bool isResponse) : _isResponse(isResponse)
+        {
+          reset();
+        }
+        
+        // Sec-WebSocket-Key or Sec-WebSocket-Accept, as sent (case matters). Empty if missing or too long to be valid
+        const char* keyValue() const 
+        {
+          return this->_key;
+        }
+        
+        bool isStatus101() const 
+        {
+          return this->_status101;
+        }
+        
+        bool hasVersion13() const 
+        {
+          return this->_version13;
+        }
+        
+      private:
+        enum State 
+        {
+          State_StartLine,
+          State_LineStart,
+          State_Name,
+          State_ValueStart,
+          State_Value,
+          State_Done
+        };
+        
+        enum Field 
+        {
+          Field_None,
+          Field_Connection,
+          Field_Upgrade,
+          Field_Version,
+          Field_Key,
+          Field_Extensions
+        };
+        
+        State   _state;
+        Field   _field;
+        size_t  _size;
+        
+        // Longest name we look for is "sec-websocket-extensions"
+        char    _name[28];
+        uint8_t _nameLength;
+        
+        // Connection / Upgrade / Version value
+        char    _value[64];
+        uint8_t _valueLength;
+        
+        // Base64 of 16 bytes is 24 characters, of a SHA-1 28
+        char    _key[32];
+        uint8_t _keyLength;
+        
+        char    _extensions[_WS_HANDSHAKE_EXTENSIONS_SIZE];
+        size_t  _extensionsLength;
+        
+        bool    _isResponse;
+        
+        bool    _status101;
+        bool    _connectionUpgrade;
+        bool    _upgradeWebsocket;
+        bool    _version13;
+        bool    _keyTooLong;
+        bool    _extensionsTooLong;
+        
+        void startLineChar(const char c);
+        void endName();
+        void valueChar(const char c);
+        void endValue();
+    };    // class HandshakeParser
+    
+    // The client's upgrade request, on the server
+    class HandshakeRequestParser : public HandshakeParser 
+    {
+      public:
+        HandshakeRequestParser() : HandshakeParser(false) {}
+        
+        // Sec-WebSocket-Version: 13
+        bool isVersion13() const 
+        {
+          return hasVersion13();
+        }
+        
+        // Sec-WebSocket-Key, as sent (case matters). Empty if missing or too long to be valid
+        const char* key() const 
+        {
+          return keyValue();
+        }
+    };    // class HandshakeRequestParser
+    
+    // The server's response, on the client
+    class HandshakeResponseParser : public HandshakeParser 
+    {
+      public:
+        HandshakeResponseParser() : HandshakeParser(true) {}
+        
+        // HTTP/1.1 101 status line
+        bool isSwitchingProtocols() const 
+        {
+          return isStatus101();
+        }
+        
+        // Sec-WebSocket-Accept, as sent. Empty if missing
+        const char* accept() const 
+        {
+          return keyValue();
+        }
+    };    // class HandshakeResponseParser
+  }   // namespace internals2_generic
+}     // namespace websockets2_generic
@@ -0,0 +1,157 @@
+/****************************************************************************************************************************
+  ws_mask.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+ 
+#pragma once
+
+// Kept free of Arduino dependencies, so the kernel can also be built and benchmarked on a host
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#if !defined(_WS_CONFIG_NO_SIMD_MASKING)
+  #if ( defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)) )
+    #include <emmintrin.h>
+    #define _WS_MASK_USE_SSE2     true
+  #elif ( defined(__ARM_NEON) || defined(__ARM_NEON__) )
+    #include <arm_neon.h>
+    #define _WS_MASK_USE_NEON     true
+  #endif
+#endif
+
+namespace websockets2_generic
+{
+  namespace internals2_generic
+  {
+    // Word used by the scalar loop: 64 bits on 64-bit hosts, 32 bits on the MCUs
+#if (UINTPTR_MAX > 0xFFFFFFFFUL)
+    typedef uint64_t WSMaskWordBase;
+#else
+    typedef uint32_t WSMaskWordBase;
+#endif
+
+#if defined(__GNUC__)
+    // Payload buffers are char arrays, so the word accesses must be allowed to alias them
+    typedef WSMaskWordBase __attribute__((__may_alias__)) WSMaskWord;
+#else
+    typedef WSMaskWordBase WSMaskWord;
+#endif
+
+#if ( _WS_MASK_USE_SSE2 || _WS_MASK_USE_NEON )
+    #define _WS_MASK_ALIGNMENT    16
+#else
+    #define _WS_MASK_ALIGNMENT    sizeof(WSMaskWord)
+#endif
+
+    // XOR `len` bytes of `src` with the RFC6455 masking key and store them in `dst`, which may be the same
+    // buffer as `src`. `offset` is the position of src[0] inside the frame payload, so that a payload can
+    // be (un)masked chunk by chunk, e.g. while copying it into a small send buffer.
+    inline void maskPayload(uint8_t* dst, const uint8_t* src, size_t len, const uint8_t* maskingKey, size_t offset = 0)
+    {
+      size_t keyIndex = offset & 3;
+      
+      // Unaligned head, until dst is aligned for the wide stores
+      while (len > 0 && (reinterpret_cast<uintptr_t>(dst) & (_WS_MASK_ALIGNMENT - 1)) != 0)
+      {
+        *dst++ = *src++ ^ maskingKey[keyIndex];
+        keyIndex = (keyIndex + 1) & 3;
+        len--;
+      }
+      
+      if (len >= sizeof(WSMaskWord))
+      {
+        // Key rotated to the current position. 16 and the word sizes are multiples of 4,
+        // so this rotation stays valid for every wide step below
+        uint8_t rotatedKey[16];
+        
+        for (size_t i = 0; i < sizeof(rotatedKey); i++)
+        {
+          rotatedKey[i] = maskingKey[(keyIndex + i) & 3];
+        }
+
+#if _WS_MASK_USE_SSE2
+        const __m128i key128 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rotatedKey));
+        
+        while (len >= 16)
+        {
+          const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+          _mm_store_si128(reinterpret_cast<__m128i*>(dst), _mm_xor_si128(chunk, key128));
+          
+          src += 16;
+          dst += 16;
+          len -= 16;
+        }
+#elif _WS_MASK_USE_NEON
+        const uint8x16_t key128 = vld1q_u8(rotatedKey);
+        
+        while (len >= 16)
+        {
+          vst1q_u8(dst, veorq_u8(vld1q_u8(src), key128));
+          
+          src += 16;
+          dst += 16;
+          len -= 16;
+        }
+#endif
+
+        WSMaskWord keyWord;
+        memcpy(&keyWord, rotatedKey, sizeof(keyWord));
+        
+        const bool srcAligned = (reinterpret_cast<uintptr_t>(src) & (sizeof(WSMaskWord) - 1)) == 0;
+        
+        while (len >= sizeof(WSMaskWord))
+        {
+          WSMaskWord word;
+          
+          if (srcAligned)
+          {
+            word = *reinterpret_cast<const WSMaskWord*>(src);
+          }
+          else
+          {
+            memcpy(&word, src, sizeof(word));
+          }
+          
+          *reinterpret_cast<WSMaskWord*>(dst) = word ^ keyWord;
+          
+          src += sizeof(WSMaskWord);
+          dst += sizeof(WSMaskWord);
+          len -= sizeof(WSMaskWord);
+        }
+      }
+      
+      // Tail
+      while (len > 0)
+      {
+        *dst++ = *src++ ^ maskingKey[keyIndex];
+        keyIndex = (keyIndex + 1) & 3;
+        len--;
+      }
+    }
+    
+    // In-place version
+    inline void maskPayload(uint8_t* data, size_t len, const uint8_t* maskingKey, size_t offset = 0)
+    {
+      maskPayload(data, data, len, maskingKey, offset);
+    }
+  }   // namespace internals2_generic
+}     // namespace websockets2_generic
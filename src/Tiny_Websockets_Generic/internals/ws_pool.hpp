@@ -0,0 +1,166 @@
+/****************************************************************************************************************************
+  ws_pool.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+ 
+#pragma once
+
+#include <Tiny_Websockets_Generic/ws_config_defs.hpp>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace websockets2_generic
+{
+  typedef void* (*AllocateFunction)(size_t size);
+  typedef void  (*DeallocateFunction)(void* ptr, size_t size);
+  
+  // Where the pool gets its blocks from, e.g. PSRAM or a static arena. Default to malloc() / free().
+  // Call it before any connection exists: blocks are returned to the functions they came from.
+  // With _WS_CONFIG_STATIC_STRINGS, only used if the static blocks ever run out, and only once set:
+  // the pool never falls back to the heap behind the application's back
+  void setPoolAllocator(AllocateFunction allocate, DeallocateFunction deallocate);
+  
+  // Blocks currently kept for reuse, and their total size
+  size_t poolCachedBlocks();
+  size_t poolCachedBytes();
+  
+  // Gives all kept blocks back
+  void poolRelease();
+  
+#ifdef _WS_CONFIG_STATIC_STRINGS
+  // Allocations the static blocks could not serve. Without setPoolAllocator() each one failed (std::bad_alloc
+  // where exceptions are enabled, a null pointer otherwise). Stays at 0 when the limits in ws_config_defs.hpp
+  // fit the application
+  size_t poolArenaMisses();
+#endif
+  
+  namespace internals2_generic
+  {
+    // Size classes of _WS_POOL_MIN_BLOCK << n bytes, each with a short free list. A freed block is kept
+    // for the next allocation of its class, so the same blocks go round instead of the heap being cut
+    // into ever smaller pieces. Not thread safe: use the library from one task
+    class BufferPool 
+    {
+      public:
+        void* allocate(const size_t size);
+        void deallocate(void* ptr, const size_t size);
+        
+        size_t cachedBlocks() const;
+        size_t cachedBytes() const;
+        void release();
+        
+        AllocateFunction    allocateFunction    = nullptr;
+        DeallocateFunction  deallocateFunction  = nullptr;
+        
+      private:
+        struct FreeBlock 
+        {
+          FreeBlock* next;
+        };
+        
+        FreeBlock*  _free[_WS_POOL_SIZE_CLASSES]  = {};
+        uint16_t    _count[_WS_POOL_SIZE_CLASSES] = {};
+        
+        static int sizeClass(const size_t size);
+        
+    #ifdef _WS_CONFIG_STATIC_STRINGS
+      public:
+        // Every size class gets _WS_POOL_STATIC_BLOCKS blocks, one after the other
+        static constexpr size_t ArenaSize = 
+          static_cast<size_t>(_WS_POOL_STATIC_BLOCKS) * _WS_POOL_MIN_BLOCK * ((1u << _WS_POOL_SIZE_CLASSES) - 1);
+        
+        static constexpr size_t LargestBlock = static_cast<size_t>(_WS_POOL_MIN_BLOCK) << (_WS_POOL_SIZE_CLASSES - 1);
+        
+        BufferPool();
+        
+        size_t arenaMisses() const 
+        {
+          return this->_arenaMisses;
+        }
+        
+      private:
+        alignas(8) uint8_t _arena[ArenaSize];
+        size_t  _arenaMisses = 0;
+        
+        // Size class of a block of the arena, -1 if it came from the heap
+        int arenaClass(const void* ptr) const;
+    #endif
+        
+        void* heapAllocate(const size_t size);
+        void  heapDeallocate(void* ptr, const size_t size);
+    };
+    
+    BufferPool& bufferPool();
+    
+    // std::allocator on top of bufferPool(), for WSString
+    template <class T>
+    struct PoolAllocator 
+    {
+      typedef T value_type;
+      
+      PoolAllocator() noexcept {}
+      
+      template <class U>
+      PoolAllocator(const PoolAllocator<U>&) noexcept {}
+      
+    #ifdef _WS_CONFIG_STATIC_STRINGS
+      // Keeps strings from growing past the largest block: basic_string caps its capacity (doubling included)
+      // at (max_size() - 1) / 2, which leaves room for the terminating zero
+      size_t max_size() const noexcept 
+      {
+        return 2 * (BufferPool::LargestBlock / sizeof(T)) - 1;
+      }
+    #endif
+      
+      T* allocate(const size_t n) 
+      {
+        return static_cast<T*>(bufferPool().allocate(n * sizeof(T)));
+      }
+      
+      void deallocate(T* ptr, const size_t n) noexcept 
+      {
+        bufferPool().deallocate(ptr, n * sizeof(T));
+      }
+      
+      template <class U>
+      bool operator==(const PoolAllocator<U>&) const noexcept 
+      {
+        return true;
+      }
+      
+      template <class U>
+      bool operator!=(const PoolAllocator<U>&) const noexcept 
+      {
+        return false;
+      }
+    };
+  }   // namespace internals2_generic
+  
+  static_assert(_WS_POOL_FREE_BLOCKS <= 0xffff, "_WS_POOL_FREE_BLOCKS must fit the 16-bit block counters");
+  
+#ifdef _WS_CONFIG_STATIC_STRINGS
+  static_assert(_WS_POOL_STATIC_BLOCKS <= 0xffff, "_WS_POOL_STATIC_BLOCKS must fit the 16-bit block counters");
+  
+  static_assert(_WS_CONFIG_MAX_MESSAGE_SIZE < internals2_generic::BufferPool::LargestBlock, 
+                "_WS_CONFIG_MAX_MESSAGE_SIZE must fit in the largest pool block, raise _WS_POOL_SIZE_CLASSES");
+#endif
+}     // namespace websockets2_generic
@@ -46,9 +46,9 @@ namespace websockets2_generic
         return (isalnum(c) || (c == '+') || (c == '/'));
       }
       
-      WSString base64_encode(unsigned char const* bytes_to_encode, unsigned int in_len)
+      // Writes 4 * ((in_len + 2) / 3) characters to `out`, without a terminating zero
+      void base64_encode(unsigned char const* bytes_to_encode, unsigned int in_len, char* out)
       {
-        WSString ret;
         int i = 0;
         int j = 0;
         unsigned char char_array_3[3];
@@ -66,7 +66,7 @@ namespace websockets2_generic
             char_array_4[3] = char_array_3[2] & 0x3f;
       
             for (i = 0; (i < 4) ; i++)
-              ret += base64_chars[char_array_4[i]];
+              *(out++) = base64_chars[char_array_4[i]];
       
             i = 0;
           }
@@ -83,15 +83,21 @@ namespace websockets2_generic
           char_array_4[3] = char_array_3[2] & 0x3f;
       
           for (j = 0; (j < i + 1); j++)
-            ret += base64_chars[char_array_4[j]];
+            *(out++) = base64_chars[char_array_4[j]];
       
           while ((i++ < 3))
-            ret += '=';
+            *(out++) = '=';
       
         }
+      }
       
-        return ret;
+      WSString base64_encode(unsigned char const* bytes_to_encode, unsigned int in_len)
+      {
+        WSString ret(4 * ((in_len + 2) / 3), '=');
+        
+        base64_encode(bytes_to_encode, in_len, &ret[0]);
       
+        return ret;
       }
       
       WSString base64_decode(WSString const& encoded_string)
@@ -33,6 +33,12 @@ namespace websockets2_generic
     WSString base64Encode(uint8_t* data, size_t len);
     WSString base64Decode(WSString data);
     WSString websocketsHandshakeEncodeKey(WSString key);
+    
+    // Same, written to `base64` (28 characters and a terminating zero)
+    void websocketsHandshakeEncodeKey(const char* key, char (&base64)[30]);
     WSString randomBytes(size_t len);
+    
+    // A fresh Sec-WebSocket-Key: 16 random bytes, base64 encoded into 24 characters and a terminating zero
+    void websocketsHandshakeNewKey(char (&key)[25]);
   }       // namespace crypto2_generic
 }         // namespace websockets2_generic
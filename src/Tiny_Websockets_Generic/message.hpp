@@ -67,6 +67,9 @@
 #elif WEBSOCKETS_USE_PORTENTA_H7_WIFI
   #warning WEBSOCKETS_USE_PORTENTA_H7_WIFI in client.hpp
   #include <Tiny_Websockets_Generic/internals/ws_common_WiFi_Portenta_H7.hpp>   
+#elif defined(__linux__)
+  // Host build, Linux sockets
+  #include <Tiny_Websockets_Generic/internals/ws_common.hpp>
 #else
   #warning WEBSOCKETS_USE_ESP_WIFI in message.hpp
   #include <Tiny_Websockets_Generic/internals/ws_common.hpp>  
@@ -94,7 +97,18 @@ namespace websockets2_generic
   struct WebsocketsMessage
   {
     WebsocketsMessage(MessageType msgType, const WSString& msgData, MessageRole msgRole = MessageRole::Complete) : _type(msgType), _length(msgData.size()), _data(msgData), _role(msgRole) {}
-    WebsocketsMessage() : WebsocketsMessage(MessageType::Empty, "", MessageRole::Complete) {}
+
+    // Takes over the payload buffer that was filled by the endpoint, instead of copying it
+    WebsocketsMessage(MessageType msgType, WSString&& msgData, MessageRole msgRole = MessageRole::Complete) : _type(msgType), _length(msgData.size()), _data(std::move(msgData)), _role(msgRole) {}
+
+    WebsocketsMessage() : WebsocketsMessage(MessageType::Empty, WSString(), MessageRole::Complete) {}
+    
+    // Moving hands the payload over, it is never copied on its way from the endpoint to a callback
+    WebsocketsMessage(const WebsocketsMessage& other) = default;
+    WebsocketsMessage(WebsocketsMessage&& other) = default;
+    
+    WebsocketsMessage& operator=(const WebsocketsMessage& other) = default;
+    WebsocketsMessage& operator=(WebsocketsMessage&& other) = default;
 
     static WebsocketsMessage CreateFromFrame(internals2_generic::WebsocketsFrame frame, MessageType overrideType = MessageType::Empty) 
     {
@@ -195,6 +209,7 @@ namespace websockets2_generic
       return this->_role == MessageRole::Last;
     }
 
+    // A copy, converted to the interface string. c_str() / length() and rawData() give the payload as is
     WSInterfaceString data() const 
     {
       return internals2_generic::fromInternalString(this->_data);
@@ -205,6 +220,17 @@ namespace websockets2_generic
       return this->_data;
     }
     
+    // Hands the payload over without copying it, the message is left empty
+    WSString takeData() 
+    {
+      WSString data = std::move(this->_data);
+      
+      this->_data.clear();
+      this->_length = 0;
+      
+      return data;
+    }
+    
     const char* c_str() const 
     {
       return this->_data.c_str();
@@ -220,7 +246,7 @@ namespace websockets2_generic
       public:
         StreamBuilder(bool dummyMode = false) : _dummyMode(dummyMode), _empty(true) {}
 
-        void first(const internals2_generic::WebsocketsFrame& frame) 
+        void first(internals2_generic::WebsocketsFrame& frame) 
         {
           if (this->_empty == false) 
           {
@@ -253,7 +279,7 @@ namespace websockets2_generic
           }
         }
 
-        void append(const internals2_generic::WebsocketsFrame& frame) 
+        void append(internals2_generic::WebsocketsFrame& frame) 
         {
           if (isErrored()) 
             return;
@@ -277,7 +303,7 @@ namespace websockets2_generic
           }
         }
 
-        void end(const internals2_generic::WebsocketsFrame& frame) 
+        void end(internals2_generic::WebsocketsFrame& frame) 
         {
           if (isErrored()) 
             return;
@@ -334,6 +360,12 @@ namespace websockets2_generic
           return this->_type;
         }
 
+        // Bytes aggregated so far
+        size_t size() const 
+        {
+          return this->_content.size();
+        }
+
         WebsocketsMessage build() 
         {
           return WebsocketsMessage(
@@ -348,18 +380,41 @@ namespace websockets2_generic
         bool _empty;
         bool _isComplete = false;
         WSString _content;
-        MessageType _type;
-        bool _didErrored;
+        MessageType _type = MessageType::Empty;
+        bool _didErrored = false;
         
     };    // class StreamBuilder 
   
     private:
-      const MessageType _type;
-      const uint32_t _length;
-      const WSString _data;
-      const MessageRole _role;
-      
+      MessageType _type;
+      uint32_t _length;
+      WSString _data;
+      MessageRole _role;
+
   };    // struct WebsocketsMessage
+
+  // Describes a frame whose payload was received directly into a caller supplied buffer
+  struct WebsocketsPayloadInfo
+  {
+    MessageType type    = MessageType::Empty;
+    MessageRole role    = MessageRole::Complete;
+    size_t      length  = 0;
+
+    bool isEmpty() const
+    {
+      return this->type == MessageType::Empty;
+    }
+  };    // struct WebsocketsPayloadInfo
+
+  // A piece of a data message's payload, handed to a payload sink as it comes off the socket
+  struct WebsocketsPayloadChunk
+  {
+    MessageType     type    = MessageType::Empty;     // Text or Binary, for every fragment of the message
+    uint64_t        offset  = 0;                      // position of `data` inside the whole message
+    const char*     data    = nullptr;
+    size_t          length  = 0;
+    bool            final   = false;                  // last chunk of the message
+  };    // struct WebsocketsPayloadChunk
 }       // namespace websockets2_generic
 
 #endif    // _MESSAGE_HPP_
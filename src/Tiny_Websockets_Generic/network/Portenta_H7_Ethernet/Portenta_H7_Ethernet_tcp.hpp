@@ -69,25 +69,23 @@ namespace websockets2_generic
           return client.connected();
         }
     
-        void send(const WSString& data) override
+        bool send(const WSString& data) override
         {
-          yield();
-          client.write(reinterpret_cast<uint8_t*>(const_cast<char*>(data.c_str())), data.size());
-          yield();
+          return send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
         }
     
-        void send(const WSString&& data) override
+        bool send(const WSString&& data) override
         {
-          yield();
-          client.write(reinterpret_cast<uint8_t*>(const_cast<char*>(data.c_str())), data.size());
-          yield();
+          return send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
         }
     
-        void send(const uint8_t* data, const uint32_t len) override
+        bool send(const uint8_t* data, const uint32_t len) override
         {
           yield();
-          client.write(data, len);
+          size_t sent = client.write(data, len);
           yield();
+          
+          return sent == len;
         }
             
         WSString readLine() override
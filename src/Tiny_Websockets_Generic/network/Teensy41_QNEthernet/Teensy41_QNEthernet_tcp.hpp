@@ -72,22 +72,22 @@ namespace websockets2_generic
           return client.connected();
         }
     
-        void send(const WSString& data) override
+        bool send(const WSString& data) override
         {
-          client.writeFully(reinterpret_cast<uint8_t*>(const_cast<char*>(data.c_str())), data.size());
-          client.flush();
+          return send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
         }
     
-        void send(const WSString&& data) override
+        bool send(const WSString&& data) override
         {
-          client.writeFully(reinterpret_cast<uint8_t*>(const_cast<char*>(data.c_str())), data.size());
-          client.flush();
+          return send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
         }
     
-        void send(const uint8_t* data, const uint32_t len) override
+        bool send(const uint8_t* data, const uint32_t len) override
         {
-          client.writeFully(data, len);
+          size_t sent = client.writeFully(data, len);
           client.flush();
+          
+          return sent == len;
         }
         
         WSString readLine() override
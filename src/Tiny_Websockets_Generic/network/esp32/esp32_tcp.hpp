@@ -42,6 +42,12 @@ namespace websockets2_generic
     class SecuredEsp32TcpClient : public GenericEspTcpClient<WiFiClientSecure>
     {
       public:
+        // Reconnect by name, the certificate is checked against it
+        WSString getRemoteAddress() override 
+        {
+          return "";
+        }
+    
         void setCACert(const char* ca_cert)
         {
           this->client.setCACert(ca_cert);
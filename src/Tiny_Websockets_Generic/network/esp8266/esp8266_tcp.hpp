@@ -41,6 +41,12 @@ namespace websockets2_generic
     class SecuredEsp8266TcpClient : public GenericEspTcpClient<WiFiClientSecure> 
     {
       public:
+        // Reconnect by name, the certificate is checked against it
+        WSString getRemoteAddress() override 
+        {
+          return "";
+        }
+    
         void setInsecure() 
         {
           this->client.setInsecure();
@@ -0,0 +1,126 @@
+/****************************************************************************************************************************
+  linux_poller.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+ 
+#pragma once
+
+#ifdef __linux__ 
+
+#include <Tiny_Websockets_Generic/internals/ws_common.hpp>
+
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <memory>
+
+#ifndef _WS_LINUX_EPOLL_EVENTS
+  // Readiness events collected per epoll_wait() call
+  #define _WS_LINUX_EPOLL_EVENTS    32
+#endif
+
+namespace websockets2_generic
+{
+  namespace network2_generic
+  {
+    // Readiness of one socket, as last reported by epoll. Sockets are registered edge-triggered,
+    // so `readable` stays set until a read hits EAGAIN, and is only set again by a new edge
+    struct LinuxPollState 
+    {
+      bool readable = false;
+      bool hangup   = false;
+    };
+    
+    // One epoll instance, shared by a server and the clients it accepted. A single non-blocking
+    // epoll_wait() refreshes the readiness of every socket, instead of one syscall per socket
+    class LinuxPoller 
+    {
+      public:
+        LinuxPoller() : _epoll(::epoll_create1(EPOLL_CLOEXEC)) {}
+        
+        LinuxPoller(const LinuxPoller&) = delete;
+        LinuxPoller& operator=(const LinuxPoller&) = delete;
+        
+        bool add(const int socket, LinuxPollState* state) 
+        {
+          struct epoll_event event = {};
+          
+          event.events    = EPOLLIN | EPOLLRDHUP | EPOLLET;
+          event.data.ptr  = state;
+          
+          return ::epoll_ctl(this->_epoll, EPOLL_CTL_ADD, socket, &event) == 0;
+        }
+        
+        // Must be called before the socket is closed, `state` is not referenced afterwards
+        void remove(const int socket) 
+        {
+          struct epoll_event event = {};
+          
+          ::epoll_ctl(this->_epoll, EPOLL_CTL_DEL, socket, &event);
+        }
+        
+        // Never waits
+        void dispatch() 
+        {
+          struct epoll_event events[_WS_LINUX_EPOLL_EVENTS];
+          int count;
+          
+          do
+          {
+            count = ::epoll_wait(this->_epoll, events, _WS_LINUX_EPOLL_EVENTS, 0);
+            
+            for (int i = 0; i < count; i++) 
+            {
+              auto state = static_cast<LinuxPollState*>(events[i].data.ptr);
+              
+              if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) 
+              {
+                // EOF and errors are reported by the next read, so they count as readable too
+                state->readable = true;
+              }
+              
+              if (events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) 
+              {
+                state->hangup = true;
+              }
+            }
+          } while (count == _WS_LINUX_EPOLL_EVENTS);
+        }
+        
+        bool isValid() const 
+        {
+          return this->_epoll >= 0;
+        }
+        
+        ~LinuxPoller() 
+        {
+          if (this->_epoll >= 0)
+          {
+            ::close(this->_epoll);
+          }
+        }
+        
+      private:
+        int _epoll;
+    };
+  }   // namespace network2_generic
+}     // namespace websockets2_generic
+
+#endif // #ifdef __linux__ 
@@ -28,27 +28,333 @@
 #include <Tiny_Websockets_Generic/internals/ws_common.hpp>
 #include <Tiny_Websockets_Generic/network/tcp_client.hpp>
 #include <Tiny_Websockets_Generic/network/tcp_socket.hpp>
+#include <Tiny_Websockets_Generic/network/linux/linux_poller.hpp>
 
-#define INVALID_SOCKET -1
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <vector>
+
+#ifndef INVALID_SOCKET
+  #define INVALID_SOCKET -1
+#endif
 
 namespace websockets2_generic
 {
   namespace network2_generic
   {
+    // Non-blocking TCP socket. Readiness comes from a LinuxPoller, shared with the server for accepted
+    // clients. Writes and the handshake's readLine() wait up to _CONNECTION_TIMEOUT ms when the socket
+    // is not ready, since the TcpClient interface has no way to report a partial write
     class LinuxTcpClient : public TcpClient 
     {
       public:
-        LinuxTcpClient(int socket = INVALID_SOCKET);
-        bool connect(const WSString& host, int port) override;
-        bool poll() override;
-        bool available() override;
-        void send(const WSString& data) override;
-        void send(const WSString&& data) override;
-        void send(const uint8_t* data, const uint32_t len) override;
-        WSString readLine() override;
-        void read(uint8_t* buffer, const uint32_t len) override;
-        void close() override;
-        virtual ~LinuxTcpClient();
+        LinuxTcpClient(int socket = INVALID_SOCKET, std::shared_ptr<LinuxPoller> poller = nullptr) 
+          : _socket(INVALID_SOCKET), _poller(poller)
+        {
+          if (socket != INVALID_SOCKET)
+          {
+            attach(socket);
+          }
+        }
+        
+        // Registered with the poller by address
+        LinuxTcpClient(const LinuxTcpClient&) = delete;
+        LinuxTcpClient& operator=(const LinuxTcpClient&) = delete;
+        
+        bool connect(const WSString& host, int port) override 
+        {
+          if (!startConnect(host, port))
+            return false;
+          
+          ConnectProgress progress;
+          
+          while ( (progress = connectProgress()) == ConnectProgress_Pending ) 
+          {
+            if (!waitFor(this->_connecting, POLLOUT)) 
+            {
+              // This address doesn't answer, try the next one
+              ::close(this->_connecting);
+              this->_connecting = INVALID_SOCKET;
+              
+              if (!connectNext())
+                return false;
+            }
+          }
+          
+          return progress == ConnectProgress_Connected;
+        }
+        
+        // Name resolution (getaddrinfo) still blocks, the TCP connect doesn't
+        bool startConnect(const WSString& host, int port) override 
+        {
+          close();
+          
+          struct addrinfo hints = {};
+          struct addrinfo* result = nullptr;
+          
+          hints.ai_family   = AF_UNSPEC;
+          hints.ai_socktype = SOCK_STREAM;
+          
+          if (::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0)
+          {
+            return false;
+          }
+          
+          for (auto address = result; address != nullptr; address = address->ai_next) 
+          {
+            ResolvedAddress resolved;
+            
+            memcpy(&resolved.address, address->ai_addr, address->ai_addrlen);
+            resolved.length = address->ai_addrlen;
+            
+            this->_addresses.push_back(resolved);
+          }
+          
+          ::freeaddrinfo(result);
+          
+          return connectNext();
+        }
+        
+        ConnectProgress connectProgress() override 
+        {
+          if (this->_connecting == INVALID_SOCKET)
+          {
+            return (this->_socket != INVALID_SOCKET) ? ConnectProgress_Connected : ConnectProgress_Failed;
+          }
+          
+          struct pollfd fd = { this->_connecting, POLLOUT, 0 };
+          
+          if (::poll(&fd, 1, 0) == 0)
+          {
+            return ConnectProgress_Pending;
+          }
+          
+          int socket = this->_connecting;
+          this->_connecting = INVALID_SOCKET;
+          
+          if (connectError(socket) == 0) 
+          {
+            this->_addresses.clear();
+            
+            return attach(socket) ? ConnectProgress_Connected : ConnectProgress_Failed;
+          }
+          
+          ::close(socket);
+          
+          return connectNext() ? connectProgress() : ConnectProgress_Failed;
+        }
+        
+        WSString getRemoteAddress() override 
+        {
+          struct sockaddr_storage address;
+          socklen_t               length = sizeof(address);
+          char                    text[INET6_ADDRSTRLEN] = "";
+          
+          if (this->_socket == INVALID_SOCKET || ::getpeername(this->_socket, reinterpret_cast<struct sockaddr*>(&address), &length) != 0)
+          {
+            return "";
+          }
+          
+          if (address.ss_family == AF_INET6)
+          {
+            ::inet_ntop(AF_INET6, &reinterpret_cast<struct sockaddr_in6*>(&address)->sin6_addr, text, sizeof(text));
+          }
+          else
+          {
+            ::inet_ntop(AF_INET, &reinterpret_cast<struct sockaddr_in*>(&address)->sin_addr, text, sizeof(text));
+          }
+          
+          return text;
+        }
+        
+        bool poll() override 
+        {
+          if (this->_socket == INVALID_SOCKET)
+            return false;
+          
+          if (!this->_state.readable)
+          {
+            this->_poller->dispatch();
+          }
+          
+          return this->_state.readable;
+        }
+        
+        bool available() override 
+        {
+          return this->_socket != INVALID_SOCKET;
+        }
+        
+        bool send(const WSString& data) override 
+        {
+          return send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+        }
+        
+        bool send(const WSString&& data) override 
+        {
+          return send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+        }
+        
+        bool send(const uint8_t* data, const uint32_t len) override 
+        {
+          TcpSegment segment = { data, len };
+          
+          return sendSegments(&segment, 1);
+        }
+        
+        // One writev() for the whole frame, resumed where the kernel stopped on a partial write.
+        // False if the socket failed (and was closed) before everything went out
+        bool sendSegments(const TcpSegment* segments, const size_t count) override 
+        {
+          size_t  index   = 0;
+          size_t  offset  = 0;      // already sent from segments[index]
+          
+          while (index < count && this->_socket != INVALID_SOCKET) 
+          {
+            struct iovec  iov[IOV_MAX < 16 ? IOV_MAX : 16];
+            int           iovCount = 0;
+            
+            for (size_t i = index; i < count && iovCount < (int) (sizeof(iov) / sizeof(iov[0])); i++) 
+            {
+              size_t skip = (i == index) ? offset : 0;
+              
+              if (segments[i].len > skip) 
+              {
+                iov[iovCount].iov_base  = const_cast<uint8_t*>(segments[i].data) + skip;
+                iov[iovCount].iov_len   = segments[i].len - skip;
+                iovCount++;
+              }
+            }
+            
+            if (iovCount == 0)
+              return true;
+            
+            struct msghdr message = {};
+            
+            message.msg_iov     = iov;
+            message.msg_iovlen  = iovCount;
+            
+            ssize_t sent = ::sendmsg(this->_socket, &message, MSG_NOSIGNAL);
+            
+            if (sent < 0) 
+            {
+              if ((errno == EAGAIN || errno == EWOULDBLOCK) && waitFor(this->_socket, POLLOUT))
+                continue;
+              
+              if (errno == EINTR)
+                continue;
+              
+              close();
+              return false;
+            }
+            
+            // Advance over what was written
+            size_t done = static_cast<size_t>(sent);
+            
+            while (index < count && done >= segments[index].len - offset) 
+            {
+              done -= segments[index].len - offset;
+              offset = 0;
+              index++;
+            }
+            
+            offset += done;
+          }
+          
+          return index >= count;
+        }
+        
+        WSString readLine() override 
+        {
+          WSString line;
+          uint8_t  byte = '0';
+          
+          while (byte != '\n' && this->_socket != INVALID_SOCKET) 
+          {
+            uint32_t numRead = read(&byte, 1);
+            
+            if (numRead == static_cast<uint32_t>(-1)) 
+            {
+              if (!waitFor(this->_socket, POLLIN))
+                break;
+              
+              continue;
+            }
+            
+            if (numRead == 0)
+              break;
+            
+            line += static_cast<char>(byte);
+          }
+          
+          return line;
+        }
+        
+        // Returns -1 when nothing is available right now, 0 once the peer closed (the socket is then closed too)
+        uint32_t read(uint8_t* buffer, const uint32_t len) override 
+        {
+          if (this->_socket == INVALID_SOCKET)
+            return 0;
+          
+          ssize_t numRead;
+          
+          do
+          {
+            numRead = ::recv(this->_socket, buffer, len, 0);
+          } while (numRead < 0 && errno == EINTR);
+          
+          if (numRead > 0)
+          {
+            return static_cast<uint32_t>(numRead);
+          }
+          
+          if (numRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) 
+          {
+            // Drained, wait for the next edge
+            this->_state.readable = false;
+            
+            return static_cast<uint32_t>(-1);
+          }
+          
+          close();
+          
+          return 0;
+        }
+        
+        void close() override 
+        {
+          if (this->_connecting != INVALID_SOCKET) 
+          {
+            ::close(this->_connecting);
+            this->_connecting = INVALID_SOCKET;
+          }
+          
+          this->_addresses.clear();
+          
+          if (this->_socket == INVALID_SOCKET)
+            return;
+          
+          this->_poller->remove(this->_socket);
+          ::close(this->_socket);
+          
+          this->_socket = INVALID_SOCKET;
+          this->_state  = LinuxPollState();
+        }
+        
+        virtual ~LinuxTcpClient() 
+        {
+          close();
+        }
     
       protected:
         virtual int getSocket() const override 
@@ -57,7 +363,107 @@ namespace websockets2_generic
         }
     
       private:
+        struct ResolvedAddress 
+        {
+          struct sockaddr_storage address;
+          socklen_t               length;
+        };
+        
         int _socket;
+        std::shared_ptr<LinuxPoller> _poller;
+        LinuxPollState _state;
+        
+        // Connect in progress, and the addresses left to try
+        int _connecting = INVALID_SOCKET;
+        std::vector<ResolvedAddress> _addresses;
+        
+        bool connectNext() 
+        {
+          while (!this->_addresses.empty()) 
+          {
+            ResolvedAddress resolved = this->_addresses.front();
+            this->_addresses.erase(this->_addresses.begin());
+            
+            int socket = ::socket(resolved.address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            
+            if (socket == INVALID_SOCKET)
+              continue;
+            
+            if (::connect(socket, reinterpret_cast<struct sockaddr*>(&resolved.address), resolved.length) == 0) 
+            {
+              // Loopback may connect at once
+              this->_addresses.clear();
+              
+              return attach(socket);
+            }
+            
+            if (errno == EINPROGRESS) 
+            {
+              this->_connecting = socket;
+              
+              return true;
+            }
+            
+            ::close(socket);
+          }
+          
+          return false;
+        }
+        
+        bool attach(const int socket) 
+        {
+          int flags = ::fcntl(socket, F_GETFL, 0);
+          ::fcntl(socket, F_SETFL, flags | O_NONBLOCK);
+          
+          // Frames are written whole (sendSegments), there is nothing for Nagle to coalesce
+          int noDelay = 1;
+          ::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+          
+          if (!this->_poller)
+          {
+            this->_poller = std::make_shared<LinuxPoller>();
+          }
+          
+          // Data may be there before the first edge is seen
+          this->_state.readable = true;
+          
+          if (!this->_poller->add(socket, &this->_state)) 
+          {
+            ::close(socket);
+            
+            return false;
+          }
+          
+          this->_socket = socket;
+          
+          return true;
+        }
+        
+        static bool waitFor(const int socket, const short events) 
+        {
+          struct pollfd fd = { socket, events, 0 };
+          int result;
+          
+          do
+          {
+            result = ::poll(&fd, 1, _CONNECTION_TIMEOUT);
+          } while (result < 0 && errno == EINTR);
+          
+          return result > 0;
+        }
+        
+        static int connectError(const int socket) 
+        {
+          int       error   = 0;
+          socklen_t length  = sizeof(error);
+          
+          if (::getsockopt(socket, SOL_SOCKET, SO_ERROR, &error, &length) != 0)
+          {
+            return errno;
+          }
+          
+          return error;
+        }
     };
   }   // namespace network2_generic
 }     // namespace websockets2_generic
@@ -29,22 +29,157 @@
 #include <Tiny_Websockets_Generic/network/tcp_server.hpp>
 #include <Tiny_Websockets_Generic/network/linux/linux_tcp_client.hpp>
 
-#define DEFAULT_BACKLOG_SIZE 5
+#ifndef _WS_LINUX_LISTEN_BACKLOG
+  // Pending connections the kernel queues while the server is busy, capped by net.core.somaxconn
+  #define _WS_LINUX_LISTEN_BACKLOG    SOMAXCONN
+#endif
+
+// Kept for code that still refers to it
+#define DEFAULT_BACKLOG_SIZE _WS_LINUX_LISTEN_BACKLOG
 
 namespace websockets2_generic
 {
   namespace network2_generic
   {
+    // Non-blocking listening socket. Accepted clients share its LinuxPoller, so one epoll_wait()
+    // per round updates the server and all of its connections
     class LinuxTcpServer : public TcpServer 
     {
       public:
-        LinuxTcpServer(size_t backlog = DEFAULT_BACKLOG_SIZE) : _num_backlog(backlog) {}
-        bool listen(const uint16_t port) override;
-        bool poll() override;
-        TcpClient* accept() override;
-        bool available() override;
-        void close() override;
-        virtual ~LinuxTcpServer();
+        LinuxTcpServer(size_t backlog = _WS_LINUX_LISTEN_BACKLOG) 
+          : _socket(INVALID_SOCKET), _num_backlog(backlog), _poller(std::make_shared<LinuxPoller>()) {}
+          
+        LinuxTcpServer(const LinuxTcpServer&) = delete;
+        LinuxTcpServer& operator=(const LinuxTcpServer&) = delete;
+        
+        bool listen(const uint16_t port) override 
+        {
+          close();
+          
+          int socket = ::socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+          
+          if (socket != INVALID_SOCKET) 
+          {
+            // Dual stack, IPv4 clients show up as mapped addresses
+            int off = 0;
+            ::setsockopt(socket, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+            
+            struct sockaddr_in6 address = {};
+            
+            address.sin6_family = AF_INET6;
+            address.sin6_addr   = in6addr_any;
+            address.sin6_port   = htons(port);
+            
+            if (!bindAndListen(socket, reinterpret_cast<struct sockaddr*>(&address), sizeof(address))) 
+            {
+              ::close(socket);
+              socket = INVALID_SOCKET;
+            }
+          }
+          
+          if (socket == INVALID_SOCKET) 
+          {
+            // No IPv6 on this host
+            socket = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            
+            if (socket == INVALID_SOCKET)
+              return false;
+            
+            struct sockaddr_in address = {};
+            
+            address.sin_family      = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_ANY);
+            address.sin_port        = htons(port);
+            
+            if (!bindAndListen(socket, reinterpret_cast<struct sockaddr*>(&address), sizeof(address))) 
+            {
+              ::close(socket);
+              
+              return false;
+            }
+          }
+          
+          // A client may already be queued
+          this->_state.readable = true;
+          
+          if (!this->_poller->add(socket, &this->_state)) 
+          {
+            ::close(socket);
+            
+            return false;
+          }
+          
+          this->_socket = socket;
+          
+          return true;
+        }
+        
+        // Also refreshes the readiness of every accepted client
+        bool poll() override 
+        {
+          if (this->_socket == INVALID_SOCKET)
+            return false;
+          
+          if (!this->_state.readable)
+          {
+            this->_poller->dispatch();
+          }
+          
+          return this->_state.readable;
+        }
+        
+        // Returns nullptr when no client is waiting
+        TcpClient* accept() override 
+        {
+          while (this->_socket != INVALID_SOCKET) 
+          {
+            int client = ::accept4(this->_socket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            
+            if (client >= 0)
+            {
+              return new LinuxTcpClient(client, this->_poller);
+            }
+            
+            if (errno == EINTR || errno == ECONNABORTED)
+              continue;
+            
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+              // Queue drained, wait for the next edge
+              this->_state.readable = false;
+            }
+            else
+            {
+              LOGERROR1("LinuxTcpServer::accept: errno =", errno);
+            }
+            
+            break;
+          }
+          
+          return nullptr;
+        }
+        
+        bool available() override 
+        {
+          return this->_socket != INVALID_SOCKET;
+        }
+        
+        void close() override 
+        {
+          if (this->_socket == INVALID_SOCKET)
+            return;
+          
+          this->_poller->remove(this->_socket);
+          ::close(this->_socket);
+          
+          this->_socket = INVALID_SOCKET;
+          this->_state  = LinuxPollState();
+        }
+        
+        virtual ~LinuxTcpServer() 
+        {
+          close();
+        }
     
       protected:
         virtual int getSocket() const override 
@@ -55,6 +190,16 @@ namespace websockets2_generic
       private:
         int _socket;
         size_t _num_backlog;
+        std::shared_ptr<LinuxPoller> _poller;
+        LinuxPollState _state;
+        
+        bool bindAndListen(const int socket, const struct sockaddr* address, const socklen_t length) 
+        {
+          int reuse = 1;
+          ::setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+          
+          return (::bind(socket, address, length) == 0) && (::listen(socket, static_cast<int>(this->_num_backlog)) == 0);
+        }
     };
   }   // namespace network2_generic
 }     // namespace websockets2_generic
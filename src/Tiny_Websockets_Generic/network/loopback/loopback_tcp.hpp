@@ -0,0 +1,409 @@
+/****************************************************************************************************************************
+  loopback_tcp.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+ 
+#pragma once
+
+#include <Tiny_Websockets_Generic/internals/ws_common.hpp>
+#include <Tiny_Websockets_Generic/network/tcp_client.hpp>
+#include <Tiny_Websockets_Generic/network/tcp_server.hpp>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace websockets2_generic
+{
+  namespace network2_generic
+  {
+    // In-process transport: a LoopbackTcpClient connects to the LoopbackTcpServer listening on the same
+    // LoopbackNetwork and port, the host name is ignored. Each direction is a byte queue, no kernel and
+    // no threads are involved, so everything runs from the callers' poll() loops. As nothing blocks,
+    // use connectAsync() and poll both ends (connect() would wait for a response the server can't send).
+    //
+    // setChunking() makes read() return fewer bytes than are queued, to exercise partial reads the way
+    // a real network would, but repeatably: with a seed the sizes are pseudo random in [1, maxChunk],
+    // without one every read returns up to maxChunk
+    class LoopbackTcpServer;
+    
+    struct LoopbackChunking 
+    {
+      uint32_t  maxChunk  = 0;      // 0: reads return everything queued, up to the caller's length
+      uint32_t  seed      = 0;      // 0: fixed size reads of maxChunk
+    };
+    
+    // One direction of a connection
+    struct LoopbackPipe 
+    {
+      std::vector<uint8_t>  data;
+      size_t                head          = 0;        // first unread byte
+      bool                  writerClosed  = false;    // EOF once drained
+      bool                  readerClosed  = false;    // further writes are lost, the writer closes
+      
+      size_t size() const 
+      {
+        return this->data.size() - this->head;
+      }
+      
+      void write(const uint8_t* bytes, const uint32_t len) 
+      {
+        // Compact once the unread part is smaller than what was read, so the buffer doesn't grow forever
+        if (this->head > 0 && this->head >= this->size()) 
+        {
+          this->data.erase(this->data.begin(), this->data.begin() + this->head);
+          this->head = 0;
+        }
+        
+        this->data.insert(this->data.end(), bytes, bytes + len);
+      }
+      
+      uint32_t read(uint8_t* bytes, const uint32_t len) 
+      {
+        uint32_t count = (this->size() < len) ? static_cast<uint32_t>(this->size()) : len;
+        
+        memcpy(bytes, this->data.data() + this->head, count);
+        this->head += count;
+        
+        if (this->head == this->data.size()) 
+        {
+          this->data.clear();
+          this->head = 0;
+        }
+        
+        return count;
+      }
+    };
+    
+    class LoopbackNetwork 
+    {
+      public:
+        void setChunking(const uint32_t maxChunk, const uint32_t seed = 0) 
+        {
+          this->_chunking.maxChunk  = maxChunk;
+          this->_chunking.seed      = seed;
+        }
+        
+        // Taken by connections when they are opened
+        const LoopbackChunking& getChunking() const 
+        {
+          return this->_chunking;
+        }
+        
+        LoopbackTcpServer* findListener(const uint16_t port) const 
+        {
+          auto listener = this->_listeners.find(port);
+          
+          return (listener == this->_listeners.end()) ? nullptr : listener->second;
+        }
+        
+        bool addListener(const uint16_t port, LoopbackTcpServer* server) 
+        {
+          return this->_listeners.insert(std::make_pair(port, server)).second;
+        }
+        
+        void removeListener(const LoopbackTcpServer* server) 
+        {
+          for (auto listener = this->_listeners.begin(); listener != this->_listeners.end(); ++listener) 
+          {
+            if (listener->second == server) 
+            {
+              this->_listeners.erase(listener);
+              return;
+            }
+          }
+        }
+        
+        // What clients and servers constructed without a network use
+        static std::shared_ptr<LoopbackNetwork> shared() 
+        {
+          static std::shared_ptr<LoopbackNetwork> network = std::make_shared<LoopbackNetwork>();
+          
+          return network;
+        }
+        
+      private:
+        LoopbackChunking                          _chunking;
+        std::map<uint16_t, LoopbackTcpServer*>    _listeners;
+    };
+    
+    /////////////////////////////////////////////////////////
+    
+    class LoopbackTcpClient : public TcpClient 
+    {
+      public:
+        LoopbackTcpClient(std::shared_ptr<LoopbackNetwork> network = LoopbackNetwork::shared()) 
+          : _network(network) {}
+        
+        // The accepted end of a connection
+        LoopbackTcpClient(std::shared_ptr<LoopbackNetwork> network, std::shared_ptr<LoopbackPipe> in, std::shared_ptr<LoopbackPipe> out) 
+          : _network(network)
+        {
+          attach(in, out);
+        }
+        
+        // Defined after LoopbackTcpServer. There is only one host, connections are matched on port alone
+        bool connect(const WSString& /*host*/, int port) override;
+        
+        bool poll() override 
+        {
+          return available() && (this->_in->size() > 0 || this->_in->writerClosed);
+        }
+        
+        bool available() override 
+        {
+          return this->_in != nullptr;
+        }
+        
+        bool send(const WSString& data) override 
+        {
+          return send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+        }
+        
+        bool send(const WSString&& data) override 
+        {
+          return send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+        }
+        
+        bool send(const uint8_t* data, const uint32_t len) override 
+        {
+          if (!available())
+            return false;
+          
+          if (this->_out->readerClosed) 
+          {
+            // Like EPIPE
+            close();
+            return false;
+          }
+          
+          this->_out->write(data, len);
+          
+          return true;
+        }
+        
+        // Straight into the queue, nothing to gain from packing
+        bool sendSegments(const TcpSegment* segments, const size_t count) override 
+        {
+          for (size_t i = 0; i < count; i++) 
+          {
+            if (!send(segments[i].data, segments[i].len))
+              return false;
+          }
+          
+          return true;
+        }
+        
+        // Whatever is queued up to the end of line, there is no one to wait for
+        WSString readLine() override 
+        {
+          WSString line;
+          uint8_t  byte = '0';
+          
+          while (byte != '\n' && poll()) 
+          {
+            if (read(&byte, 1) != 1)
+              break;
+            
+            line += static_cast<char>(byte);
+          }
+          
+          return line;
+        }
+        
+        // Returns -1 when nothing is queued, 0 once the peer closed and everything was read (this end is then closed too)
+        uint32_t read(uint8_t* buffer, const uint32_t len) override 
+        {
+          if (!available())
+            return 0;
+          
+          if (this->_in->size() == 0) 
+          {
+            if (this->_in->writerClosed) 
+            {
+              close();
+              return 0;
+            }
+            
+            return static_cast<uint32_t>(-1);
+          }
+          
+          uint32_t chunk = nextChunk();
+          
+          return this->_in->read(buffer, (chunk > 0 && chunk < len) ? chunk : len);
+        }
+        
+        void close() override 
+        {
+          if (!available())
+            return;
+          
+          this->_in->readerClosed   = true;
+          this->_out->writerClosed  = true;
+          
+          this->_in.reset();
+          this->_out.reset();
+        }
+        
+        virtual ~LoopbackTcpClient() 
+        {
+          close();
+        }
+        
+      protected:
+        virtual int getSocket() const override 
+        {
+          return -1;
+        }
+        
+      private:
+        std::shared_ptr<LoopbackNetwork>  _network;
+        std::shared_ptr<LoopbackPipe>     _in;
+        std::shared_ptr<LoopbackPipe>     _out;
+        LoopbackChunking                  _chunking;
+        
+        void attach(std::shared_ptr<LoopbackPipe> in, std::shared_ptr<LoopbackPipe> out) 
+        {
+          this->_in       = in;
+          this->_out      = out;
+          this->_chunking = this->_network->getChunking();
+        }
+        
+        // xorshift32, so a seed always gives the same sequence of read sizes
+        uint32_t nextChunk() 
+        {
+          if (this->_chunking.maxChunk == 0 || this->_chunking.seed == 0)
+            return this->_chunking.maxChunk;
+          
+          uint32_t x = this->_chunking.seed;
+          
+          x ^= x << 13;
+          x ^= x >> 17;
+          x ^= x << 5;
+          
+          this->_chunking.seed = x;
+          
+          return 1 + (x % this->_chunking.maxChunk);
+        }
+    };
+    
+    /////////////////////////////////////////////////////////
+    
+    class LoopbackTcpServer : public TcpServer 
+    {
+      public:
+        LoopbackTcpServer(std::shared_ptr<LoopbackNetwork> network = LoopbackNetwork::shared()) 
+          : _network(network) {}
+        
+        LoopbackTcpServer(const LoopbackTcpServer&) = delete;
+        LoopbackTcpServer& operator=(const LoopbackTcpServer&) = delete;
+        
+        bool listen(const uint16_t port) override 
+        {
+          close();
+          
+          this->_listening = this->_network->addListener(port, this);
+          
+          return this->_listening;
+        }
+        
+        bool poll() override 
+        {
+          return !this->_backlog.empty();
+        }
+        
+        bool available() override 
+        {
+          return this->_listening;
+        }
+        
+        TcpClient* accept() override 
+        {
+          if (this->_backlog.empty())
+            return nullptr;
+          
+          TcpClient* client = this->_backlog.front();
+          this->_backlog.pop_front();
+          
+          return client;
+        }
+        
+        // Called by LoopbackTcpClient::connect(), the server side is queued until accept()
+        void enqueue(std::shared_ptr<LoopbackPipe> in, std::shared_ptr<LoopbackPipe> out) 
+        {
+          this->_backlog.push_back(new LoopbackTcpClient(this->_network, in, out));
+        }
+        
+        void close() override 
+        {
+          if (this->_listening) 
+          {
+            this->_network->removeListener(this);
+            this->_listening = false;
+          }
+          
+          for (auto client : this->_backlog) 
+          {
+            delete client;
+          }
+          
+          this->_backlog.clear();
+        }
+        
+        virtual ~LoopbackTcpServer() 
+        {
+          close();
+        }
+        
+      protected:
+        int getSocket() const override 
+        {
+          return -1;
+        }
+        
+      private:
+        std::shared_ptr<LoopbackNetwork>  _network;
+        bool                              _listening = false;
+        std::deque<LoopbackTcpClient*>    _backlog;
+    };
+    
+    /////////////////////////////////////////////////////////
+    
+    inline bool LoopbackTcpClient::connect(const WSString& /*host*/, int port) 
+    {
+      close();
+      
+      LoopbackTcpServer* server = this->_network->findListener(static_cast<uint16_t>(port));
+      
+      if (server == nullptr)
+        return false;
+      
+      auto toServer = std::make_shared<LoopbackPipe>();
+      auto toClient = std::make_shared<LoopbackPipe>();
+      
+      attach(toClient, toServer);
+      server->enqueue(toServer, toClient);
+      
+      return true;
+    }
+  }   // namespace network2_generic
+}     // namespace websockets2_generic
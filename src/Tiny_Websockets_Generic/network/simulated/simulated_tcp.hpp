@@ -0,0 +1,538 @@
+/****************************************************************************************************************************
+  simulated_tcp.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+ 
+#pragma once
+
+#include <Tiny_Websockets_Generic/internals/ws_common.hpp>
+#include <Tiny_Websockets_Generic/network/tcp_client.hpp>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace websockets2_generic
+{
+  namespace network2_generic
+  {
+    // What SimulatedTcpClient does to the traffic. Zero turns a feature off. Chances are per mille
+    struct NetworkConditions 
+    {
+      uint32_t  latency       = 0;    // ms added to every chunk, in each direction
+      uint32_t  jitter        = 0;    // up to this many ms more, chunks still arrive in order
+      uint32_t  bandwidth     = 0;    // bytes / s, in each direction
+      uint32_t  maxRead       = 0;    // read() returns 1 to maxRead bytes
+      uint32_t  maxWrite      = 0;    // writes reach the wrapped client in pieces of 1 to maxWrite bytes
+      uint32_t  stallChance   = 0;    // per read() with data waiting, nothing arrives for stallTime ms
+      uint32_t  stallTime     = 0;
+      uint32_t  dropAfter     = 0;    // the connection is cut after 1 to dropAfter bytes (in + out)
+      uint32_t  seed          = 1;    // same seed, same sequence of sizes, delays, stalls and drops
+      
+      // 2G-class cellular backhaul: slow, long and variable round trips, small reads, frequent stalls
+      static NetworkConditions Cellular2G() 
+      {
+        NetworkConditions conditions;
+        
+        conditions.latency      = 300;
+        conditions.jitter       = 400;
+        conditions.bandwidth    = 12 * 1024;
+        conditions.maxRead      = 256;
+        conditions.maxWrite     = 512;
+        conditions.stallChance  = 20;
+        conditions.stallTime    = 500;
+        
+        return conditions;
+      }
+      
+      // Congested 2.4 GHz Wi-Fi: fast when it works, retransmission stalls and jitter when it doesn't
+      static NetworkConditions CongestedWifi() 
+      {
+        NetworkConditions conditions;
+        
+        conditions.latency      = 20;
+        conditions.jitter       = 80;
+        conditions.bandwidth    = 256 * 1024;
+        conditions.maxRead      = 1460;
+        conditions.maxWrite     = 1460;
+        conditions.stallChance  = 10;
+        conditions.stallTime    = 150;
+        
+        return conditions;
+      }
+    };
+    
+    // Decorator for any TcpClient, e.g. 
+    //   WebsocketsClient client(std::make_shared<SimulatedTcpClient>(std::make_shared<WSDefaultTcpClient>(), NetworkConditions::Cellular2G()));
+    // Incoming bytes are pulled from the wrapped client as they come and held back until their delay
+    // has passed, outgoing bytes are held the same way and passed on from send() / poll() / read().
+    // Everything happens on the caller's thread, driven by millis()
+    class SimulatedTcpClient : public TcpClient 
+    {
+      public:
+        SimulatedTcpClient(std::shared_ptr<TcpClient> client, const NetworkConditions& conditions = NetworkConditions()) 
+          : _client(client)
+        {
+          setConditions(conditions);
+        }
+        
+        void setConditions(const NetworkConditions& conditions) 
+        {
+          this->_conditions = conditions;
+          this->_random     = conditions.seed ? conditions.seed : 1;
+          this->_dropAt     = conditions.dropAfter ? (1 + nextRandom() % conditions.dropAfter) : 0;
+        }
+        
+        const NetworkConditions& getConditions() const 
+        {
+          return this->_conditions;
+        }
+        
+        // Bytes that went through in both directions since the last connect
+        uint64_t getTransferred() const 
+        {
+          return this->_transferred;
+        }
+        
+        bool connect(const WSString& host, int port) override 
+        {
+          if (!startConnect(host, port))
+            return false;
+          
+          ConnectProgress progress;
+          
+          while ( (progress = connectProgress()) == ConnectProgress_Pending ) 
+          {
+            yield();
+          }
+          
+          return progress == ConnectProgress_Connected;
+        }
+        
+        bool startConnect(const WSString& host, int port) override 
+        {
+          reset();
+          
+          return this->_client->startConnect(host, port);
+        }
+        
+        // The TCP handshake takes a round trip
+        ConnectProgress connectProgress() override 
+        {
+          ConnectProgress progress = this->_client->connectProgress();
+          
+          if (progress != ConnectProgress_Connected)
+            return progress;
+          
+          if (this->_connectedAt == 0) 
+          {
+            this->_connectedAt = millis() + 2 * nextDelay();
+            
+            if (this->_connectedAt == 0)
+              this->_connectedAt = 1;
+          }
+          
+          return reached(this->_connectedAt) ? ConnectProgress_Connected : ConnectProgress_Pending;
+        }
+        
+        WSString getRemoteAddress() override 
+        {
+          return this->_client->getRemoteAddress();
+        }
+        
+        bool poll() override 
+        {
+          pump();
+          
+          return !this->_closed && (released() > 0 || (this->_peerClosed && this->_in.empty()));
+        }
+        
+        bool available() override 
+        {
+          return !this->_closed;
+        }
+        
+        bool send(const WSString& data) override 
+        {
+          return send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+        }
+        
+        bool send(const WSString&& data) override 
+        {
+          return send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+        }
+        
+        // Queued bytes count as written, as with a kernel send buffer. A cut or failure of the wrapped
+        // client shows on the next send()
+        bool send(const uint8_t* data, const uint32_t len) override 
+        {
+          if (this->_closed)
+            return false;
+          
+          if (len > 0)
+            enqueue(this->_out, data, len);
+          
+          flush();
+          
+          return !this->_closed;
+        }
+        
+        bool sendSegments(const TcpSegment* segments, const size_t count) override 
+        {
+          if (this->_closed)
+            return false;
+          
+          for (size_t i = 0; i < count; i++) 
+          {
+            if (segments[i].len > 0)
+              enqueue(this->_out, segments[i].data, segments[i].len);
+          }
+          
+          flush();
+          
+          return !this->_closed;
+        }
+        
+        // Waits up to _CONNECTION_TIMEOUT ms past the current delay for each byte
+        WSString readLine() override 
+        {
+          WSString      line;
+          uint8_t       byte  = '0';
+          unsigned long start = millis();
+          
+          while (byte != '\n' && !this->_closed && millis() - start < _CONNECTION_TIMEOUT + 2 * nextDelay()) 
+          {
+            uint32_t numRead = read(&byte, 1);
+            
+            if (numRead == 0)
+              break;
+            
+            if (numRead == static_cast<uint32_t>(-1)) 
+            {
+              yield();
+              continue;
+            }
+            
+            line += static_cast<char>(byte);
+          }
+          
+          return line;
+        }
+        
+        // Returns -1 when nothing has arrived yet, 0 once the connection is gone and everything was read
+        uint32_t read(uint8_t* buffer, const uint32_t len) override 
+        {
+          pump();
+          
+          if (this->_closed)
+            return 0;
+          
+          if (!reached(this->_stalledUntil))
+            return static_cast<uint32_t>(-1);
+          
+          uint32_t count = released();
+          
+          if (count == 0) 
+          {
+            if (this->_peerClosed && this->_in.empty()) 
+            {
+              close();
+              return 0;
+            }
+            
+            return static_cast<uint32_t>(-1);
+          }
+          
+          if (this->_conditions.stallChance && (nextRandom() % 1000) < this->_conditions.stallChance) 
+          {
+            this->_stalledUntil = millis() + this->_conditions.stallTime;
+            
+            return static_cast<uint32_t>(-1);
+          }
+          
+          count = (count < len) ? count : len;
+          
+          if (this->_conditions.maxRead)
+            count = min(count, 1 + nextRandom() % this->_conditions.maxRead);
+          
+          count = min(count, this->_in.budget.take(this->_conditions.bandwidth, count));
+          
+          if (count == 0)
+            return static_cast<uint32_t>(-1);
+          
+          count = dequeue(this->_in, buffer, count);
+          
+          return transferred(count) ? count : 0;
+        }
+        
+        void close() override 
+        {
+          this->_client->close();
+          
+          this->_closed = true;
+          this->_in     = Direction();
+          this->_out    = Direction();
+        }
+        
+        virtual ~SimulatedTcpClient() 
+        {
+          close();
+        }
+        
+      protected:
+        int getSocket() const override 
+        {
+          return -1;
+        }
+        
+      private:
+        struct Chunk 
+        {
+          unsigned long         releaseAt;
+          std::vector<uint8_t>  data;
+          size_t                offset;
+        };
+        
+        // Token bucket, refilled at `bandwidth` bytes / s, holding up to 100 ms worth
+        struct Budget 
+        {
+          unsigned long refilledAt  = 0;
+          uint32_t      tokens      = 0;
+          
+          uint32_t take(const uint32_t bandwidth, const uint32_t wanted) 
+          {
+            if (bandwidth == 0)
+              return wanted;
+            
+            unsigned long now     = millis();
+            uint64_t      refill  = (uint64_t) (now - this->refilledAt) * bandwidth / 1000;
+            uint32_t      burst   = (bandwidth / 10) ? (bandwidth / 10) : 1;
+            
+            if (refill > 0) 
+            {
+              this->tokens      = (uint32_t) min((uint64_t) burst, this->tokens + refill);
+              this->refilledAt  = now;
+            }
+            
+            uint32_t granted = min(wanted, this->tokens);
+            
+            this->tokens -= granted;
+            
+            return granted;
+          }
+        };
+        
+        struct Direction 
+        {
+          std::deque<Chunk> chunks;
+          Budget            budget;
+          unsigned long     lastRelease = 0;    // keeps chunks in order despite the jitter
+          
+          bool empty() const 
+          {
+            return this->chunks.empty();
+          }
+        };
+        
+        std::shared_ptr<TcpClient>  _client;
+        NetworkConditions           _conditions;
+        uint32_t                    _random       = 1;
+        
+        Direction                   _in;
+        Direction                   _out;
+        
+        unsigned long               _connectedAt  = 0;
+        unsigned long               _stalledUntil = 0;
+        uint64_t                    _transferred  = 0;
+        uint64_t                    _dropAt       = 0;
+        bool                        _peerClosed   = false;
+        bool                        _closed       = false;
+        
+        template<class T> static T min(const T a, const T b) 
+        {
+          return (a < b) ? a : b;
+        }
+        
+        static bool reached(const unsigned long time) 
+        {
+          return static_cast<long>(millis() - time) >= 0;
+        }
+        
+        // xorshift32
+        uint32_t nextRandom() 
+        {
+          uint32_t x = this->_random;
+          
+          x ^= x << 13;
+          x ^= x >> 17;
+          x ^= x << 5;
+          
+          return this->_random = x;
+        }
+        
+        uint32_t nextDelay() 
+        {
+          return this->_conditions.latency + (this->_conditions.jitter ? nextRandom() % (this->_conditions.jitter + 1) : 0);
+        }
+        
+        void reset() 
+        {
+          setConditions(this->_conditions);
+          
+          this->_in           = Direction();
+          this->_out          = Direction();
+          this->_connectedAt  = 0;
+          this->_stalledUntil = 0;
+          this->_transferred  = 0;
+          this->_peerClosed   = false;
+          this->_closed       = false;
+        }
+        
+        void enqueue(Direction& direction, const uint8_t* data, const uint32_t len) 
+        {
+          unsigned long releaseAt = millis() + nextDelay();
+          
+          if (!direction.empty() && static_cast<long>(releaseAt - direction.lastRelease) < 0)
+            releaseAt = direction.lastRelease;
+          
+          direction.lastRelease = releaseAt;
+          
+          direction.chunks.push_back(Chunk { releaseAt, std::vector<uint8_t>(data, data + len), 0 });
+        }
+        
+        uint32_t dequeue(Direction& direction, uint8_t* buffer, uint32_t len) 
+        {
+          std::deque<Chunk>& queue = direction.chunks;
+          
+          uint32_t done = 0;
+          
+          while (done < len && !queue.empty() && reached(queue.front().releaseAt)) 
+          {
+            Chunk&    chunk = queue.front();
+            uint32_t  count = min(len - done, static_cast<uint32_t>(chunk.data.size() - chunk.offset));
+            
+            memcpy(buffer + done, chunk.data.data() + chunk.offset, count);
+            
+            chunk.offset  += count;
+            done          += count;
+            
+            if (chunk.offset == chunk.data.size())
+              queue.pop_front();
+          }
+          
+          return done;
+        }
+        
+        // Incoming bytes whose delay has passed
+        uint32_t released() const 
+        {
+          uint64_t count = 0;
+          
+          for (auto& chunk : this->_in.chunks) 
+          {
+            if (!reached(chunk.releaseAt))
+              break;
+            
+            count += chunk.data.size() - chunk.offset;
+          }
+          
+          return static_cast<uint32_t>(min(count, (uint64_t) UINT32_MAX));
+        }
+        
+        // Counts bytes towards dropAfter, false once the connection was cut
+        bool transferred(const uint32_t count) 
+        {
+          this->_transferred += count;
+          
+          if (this->_dropAt && this->_transferred >= this->_dropAt) 
+          {
+            LOGWARN1("SimulatedTcpClient: dropping the connection after bytes =", (unsigned long) this->_transferred);
+            
+            close();
+            return false;
+          }
+          
+          return true;
+        }
+        
+        // Passes on the outgoing bytes whose delay has passed, as far as the bandwidth allows
+        void flush() 
+        {
+          while (!this->_closed && !this->_out.empty() && reached(this->_out.chunks.front().releaseAt)) 
+          {
+            Chunk&    chunk = this->_out.chunks.front();
+            uint32_t  count = static_cast<uint32_t>(chunk.data.size() - chunk.offset);
+            
+            if (this->_conditions.maxWrite)
+              count = min(count, 1 + nextRandom() % this->_conditions.maxWrite);
+            
+            count = this->_out.budget.take(this->_conditions.bandwidth, count);
+            
+            if (count == 0)
+              return;
+            
+            if (!this->_client->send(chunk.data.data() + chunk.offset, count)) 
+            {
+              close();
+              return;
+            }
+            
+            chunk.offset += count;
+            
+            if (chunk.offset == chunk.data.size())
+              this->_out.chunks.pop_front();
+            
+            if (!transferred(count))
+              return;
+          }
+        }
+        
+        // Moves whatever the wrapped client has into the incoming queue, and flushes the outgoing one
+        void pump() 
+        {
+          if (this->_closed)
+            return;
+          
+          flush();
+          
+          while (!this->_closed && !this->_peerClosed && this->_client->poll()) 
+          {
+            uint8_t   buffer[_WS_BUFFER_SIZE];
+            uint32_t  numRead = this->_client->read(buffer, sizeof(buffer));
+            
+            if (numRead == static_cast<uint32_t>(-1))
+              break;
+            
+            if (numRead == 0) 
+            {
+              this->_peerClosed = true;
+              break;
+            }
+            
+            enqueue(this->_in, buffer, numRead);
+          }
+          
+          if (!this->_peerClosed && !this->_client->available())
+            this->_peerClosed = true;
+        }
+    };
+  }   // namespace network2_generic
+}     // namespace websockets2_generic
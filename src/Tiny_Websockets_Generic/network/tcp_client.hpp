@@ -30,15 +30,89 @@ namespace websockets2_generic
 {
   namespace network2_generic 
   {
+    // One buffer of a gathered write
+    struct TcpSegment 
+    {
+      const uint8_t*  data;
+      uint32_t        len;
+    };
+    
+    enum ConnectProgress 
+    {
+      ConnectProgress_Pending,
+      ConnectProgress_Connected,
+      ConnectProgress_Failed
+    };
+    
     struct TcpClient : public TcpSocket 
     {
       virtual bool poll() = 0;
-      virtual void send(const WSString& data) = 0;
-      virtual void send(const WSString&& data) = 0;
-      virtual void send(const uint8_t* data, const uint32_t len) = 0;
+      // All of them return false if not every byte could be written
+      virtual bool send(const WSString& data) = 0;
+      virtual bool send(const WSString&& data) = 0;
+      virtual bool send(const uint8_t* data, const uint32_t len) = 0;
+      
+      // Sends the segments back to back, without the caller having to concatenate them.
+      // Transports with a native gather write (writev) should override this. The default packs
+      // small segments into _WS_BUFFER_SIZE byte writes, so a frame header doesn't go out on its own
+      virtual bool sendSegments(const TcpSegment* segments, const size_t count) 
+      {
+        uint8_t   buffer[_WS_BUFFER_SIZE];
+        uint32_t  used = 0;
+        
+        for (size_t i = 0; i < count; i++) 
+        {
+          const uint8_t*  data  = segments[i].data;
+          uint32_t        len   = segments[i].len;
+          
+          if (used > 0 && used + len > sizeof(buffer)) 
+          {
+            if (!send(buffer, used))
+              return false;
+              
+            used = 0;
+          }
+          
+          if (len >= sizeof(buffer)) 
+          {
+            // Big enough to be worth its own write, straight from the caller's memory
+            if (!send(data, len))
+              return false;
+          } 
+          else if (len > 0) 
+          {
+            memcpy(buffer + used, data, len);
+            used += len;
+          }
+        }
+        
+        return (used == 0) || send(buffer, used);
+      }
+      
       virtual WSString readLine() = 0;
       virtual uint32_t read(uint8_t* buffer, const uint32_t len) = 0;
       virtual bool connect(const WSString& host, int port) = 0;
+      
+      // Non-blocking connect: startConnect() begins it, then connectProgress() is polled until it is no
+      // longer ConnectProgress_Pending. Transports without an asynchronous connect (the Arduino client
+      // libraries) do it all in startConnect(), as connect() does
+      virtual bool startConnect(const WSString& host, int port) 
+      {
+        return connect(host, port);
+      }
+      
+      virtual ConnectProgress connectProgress() 
+      {
+        return available() ? ConnectProgress_Connected : ConnectProgress_Failed;
+      }
+      
+      // Numeric address of the connected peer, so a reconnect can skip name resolution.
+      // Empty if unknown, or if the host name must be kept (TLS checks it against the certificate)
+      virtual WSString getRemoteAddress() 
+      {
+        return "";
+      }
+      
       virtual ~TcpClient() {}
     };
   }   // namespace network2_generic
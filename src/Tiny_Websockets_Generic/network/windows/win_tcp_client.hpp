@@ -52,9 +52,9 @@ namespace websockets2_generic
         bool connect(const WSString& host, const int port) override;
         bool poll() override;
         bool available() override;
-        void send(const WSString& data) override;
-        void send(const WSString&& data) override;
-        void send(const uint8_t* data, const uint32_t len) override;
+        bool send(const WSString& data) override;
+        bool send(const WSString&& data) override;
+        bool send(const uint8_t* data, const uint32_t len) override;
         WSString readLine() override;
         void read(uint8_t* buffer, const uint32_t len) override;
         void close() override;
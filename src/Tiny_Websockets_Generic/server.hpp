@@ -27,7 +27,10 @@
 #pragma once
 
 #include <Tiny_Websockets_Generic/client.hpp>
+#include <Tiny_Websockets_Generic/internals/ws_handshake.hpp>
 #include <functional>
+#include <vector>
+#include <memory>
 
 // KH, from v1.0.1
 #if (WEBSOCKETS_USE_ETHERNET || WEBSOCKETS_USE_PORTENTA_H7_ETHERNET)
@@ -68,6 +71,9 @@
 #elif WEBSOCKETS_USE_PORTENTA_H7_WIFI
   #warning WEBSOCKETS_USE_PORTENTA_H7_WIFI in client.hpp
   #include <Tiny_Websockets_Generic/internals/ws_common_WiFi_Portenta_H7.hpp>   
+#elif defined(__linux__)
+  // Host build, Linux sockets
+  #include <Tiny_Websockets_Generic/internals/ws_common.hpp>
 #else
   #warning WEBSOCKETS_USE_ESP_WIFI in server.hpp
   #include <Tiny_Websockets_Generic/internals/ws_common.hpp>  
@@ -76,6 +82,8 @@
 
 namespace websockets2_generic
 {
+  typedef std::function<void(WebsocketsClient&)> ConnectionCallback;
+  
   class WebsocketsServer 
   {
     public:
@@ -91,11 +99,71 @@ namespace websockets2_generic
       void listen(uint16_t port);
       bool poll();
       WebsocketsClient accept();
+      
+      // Once any of these callbacks is set, the server keeps its own set of connections and poll() runs it:
+      // it accepts new clients (up to setMaxConnections()), advances their handshakes without waiting on
+      // them, services every live connection in turn and drops the closed ones. The message / event callbacks
+      // are installed on each accepted connection, then onConnection() is called, and can replace them.
+      // Without them, poll() only tells whether accept() has a client waiting, as before
+      void onConnection(const ConnectionCallback callback);
+      void onMessage(const MessageCallback callback);
+      void onEvent(const EventCallback callback);
+      
+      void setMaxConnections(const size_t maxConnections);
+      size_t getConnectionsCount() const;
+      
+      // Added to every 101 Switching Protocols response, e.g. addResponseHeader("Sec-WebSocket-Protocol", "chat")
+      void addResponseHeader(const WSInterfaceString& name, const WSInterfaceString& value);
+      
+      // Sends to every live connection
+      void broadcast(const WSInterfaceString& data);
+      void broadcast(const char* data, const size_t len);
+      void broadcastBinary(const char* data, const size_t len);
   
       virtual ~WebsocketsServer();
   
     private:
       network2_generic::TcpServer* _server;
+      
+      std::vector<std::shared_ptr<WebsocketsClient>> _connections;
+      ConnectionCallback _connectionCallback;
+      MessageCallback _messagesCallback;
+      EventCallback _eventsCallback;
+      
+      // Extra response headers, ready to send
+      WSString _responseHeaders;
+      
+      bool _ownsConnections = false;
+      size_t _maxConnections = _WS_SERVER_MAX_CONNECTIONS;
+      size_t _nextConnection = 0;
+      
+      // A client whose upgrade request is still coming in. No request bytes are kept, only the parser state:
+      // about 160 + _WS_HANDSHAKE_EXTENSIONS_SIZE bytes (some 420 by default), plus the TcpClient. There are
+      // at most setMaxConnections() of them, in a vector reserved up front
+      struct PendingHandshake 
+      {
+        std::shared_ptr<network2_generic::TcpClient>  client;
+        internals2_generic::HandshakeRequestParser    request;
+        unsigned long                                 startedAt;      // millis()
+      };
+      
+      enum HandshakeStatus 
+      {
+        HandshakeStatus_Pending,
+        HandshakeStatus_Complete,
+        HandshakeStatus_Failed,       // closed or timed out, nothing to answer
+        HandshakeStatus_Rejected      // unusable request, answered with 400 Bad Request
+      };
+      
+      std::vector<PendingHandshake> _handshakes;
+      
+      bool acceptConnection();
+      bool serviceConnections();
+      
+      HandshakeStatus advanceHandshake(PendingHandshake& handshake);
+      std::shared_ptr<WebsocketsClient> upgrade(std::shared_ptr<network2_generic::TcpClient> tcpClient, 
+                                                const internals2_generic::HandshakeRequestParser& request);
+      void reject(std::shared_ptr<network2_generic::TcpClient> tcpClient);
   };
 }     // namespace websockets2_generic
 
@@ -28,6 +28,151 @@
 #define _WS_BUFFER_SIZE       512
 #define _CONNECTION_TIMEOUT   1000
 
+// RAM taken by each connection (WebsocketsClient, or each one a WebsocketsServer keeps):
+//   - the endpoint itself, _WS_RX_BUFFER_SIZE bytes of it for the receive buffer below. The endpoint lives
+//     inside the WebsocketsClient, so copying a client copies the buffer too
+//   - on a WebsocketsServer, a HandshakeRequestParser (about 160 + _WS_HANDSHAKE_EXTENSIONS_SIZE bytes) while
+//     the upgrade request comes in
+//   - with permessage-deflate negotiated, 2^_WS_DEFLATE_HASH_BITS * 2 bytes of hash table, and up to
+//     2^window bits of history when the peer keeps its compression context. The inflater's decoding tables
+//     (about 1.5 KB) are static, shared by all connections
+// Sending a masked frame (any client) also takes _WS_BUFFER_SIZE bytes of stack
+
+// Per-connection receive buffer. Frame headers and small frames are served from it, so one socket read
+// (one SPI / driver round trip) covers several of them; larger payloads are read straight into their
+// destination anyway. 128 bytes by default, on its own rather than tied to _WS_BUFFER_SIZE (a send-side
+// stack buffer). Raise it for many small messages, define as 0 to read straight from the socket
+#ifndef _WS_RX_BUFFER_SIZE
+  #define _WS_RX_BUFFER_SIZE    128
+#endif
+
+#ifndef _WS_HANDSHAKE_TIMEOUT
+  // Server side: total time (ms) a client gets to send its whole upgrade request
+  #define _WS_HANDSHAKE_TIMEOUT         5000
+#endif
+
+#ifndef _WS_CONNECT_TIMEOUT
+  // Client side: total time (ms) connect() / connectAsync() get for the TCP connection, the request and
+  // the server's whole 101 response
+  #define _WS_CONNECT_TIMEOUT           _WS_HANDSHAKE_TIMEOUT
+#endif
+
+#ifndef _WS_HANDSHAKE_MAX_SIZE
+  // Upgrade requests longer than this are rejected
+  #define _WS_HANDSHAKE_MAX_SIZE        2048
+#endif
+
+#ifndef _WS_HANDSHAKE_EXTENSIONS_SIZE
+  // Room for the Sec-WebSocket-Extensions offers or answer, held by the parser of each pending handshake.
+  // A handshake with longer ones is rejected. Our own permessage-deflate offer takes 141 bytes
+  #define _WS_HANDSHAKE_EXTENSIONS_SIZE   256
+#endif
+
+// WebsocketsClient::setReconnect() defaults, in ms / percent
+#ifndef _WS_RECONNECT_MIN_DELAY
+  #define _WS_RECONNECT_MIN_DELAY       1000
+#endif
+
+#ifndef _WS_RECONNECT_MAX_DELAY
+  #define _WS_RECONNECT_MAX_DELAY       60000
+#endif
+
+#ifndef _WS_RECONNECT_JITTER
+  #define _WS_RECONNECT_JITTER          50
+#endif
+
+#ifndef _WS_RECONNECT_MIN_INTERVAL
+  #define _WS_RECONNECT_MIN_INTERVAL    1000
+#endif
+
+#ifndef _WS_SERVER_MAX_CONNECTIONS
+  // Connections (live or still in their handshake) kept by a WebsocketsServer running its own poll loop,
+  // see WebsocketsServer::onConnection
+  #define _WS_SERVER_MAX_CONNECTIONS    8
+#endif
+
+#ifndef _WS_SERVER_MESSAGES_PER_POLL
+  // Messages handled per connection on each WebsocketsServer::poll(), so one busy client can't starve the others
+  #define _WS_SERVER_MESSAGES_PER_POLL  4
+#endif
+
+// permessage-deflate (RFC 7692) is off by default. Define _WS_CONFIG_PERMESSAGE_DEFLATE to offer / accept it
+#ifndef _WS_DEFLATE_WINDOW_BITS
+  // Largest LZ77 window (2^bits bytes) used to compress, and asked of the server when it keeps context
+  #define _WS_DEFLATE_WINDOW_BITS   10
+#endif
+
+#ifndef _WS_DEFLATE_HASH_BITS
+  // Compressor match finder, 2^bits 16-bit entries per connection
+  #define _WS_DEFLATE_HASH_BITS     10
+#endif
+
+#ifndef _WS_DEFLATE_THRESHOLD
+  // Default size below which messages are sent uncompressed
+  #define _WS_DEFLATE_THRESHOLD     64
+#endif
+
+#ifndef _WS_DEFLATE_MAX_MESSAGE_SIZE
+  // Largest inflated message accepted when _WS_CONFIG_MAX_MESSAGE_SIZE isn't set. Inflation stops as soon as
+  // the output passes it and the connection is closed with 1009 (Message Too Big), so a small compressed
+  // frame can't expand into all of RAM
+  #if defined(__linux__) || defined(_WIN32) || defined(ESP32)
+    #define _WS_DEFLATE_MAX_MESSAGE_SIZE    (1024 * 1024)
+  #else
+    #define _WS_DEFLATE_MAX_MESSAGE_SIZE    (16 * 1024)
+  #endif
+#endif
+
+// All WSString storage (payloads, stream builder, deflate buffers) comes from a pool of recycled blocks once
+// _WS_CONFIG_PAYLOAD_POOL is defined, so steady traffic stops fragmenting the heap. See ws_pool.hpp
+
+// Static strings profile: define _WS_CONFIG_STATIC_STRINGS and the pool's blocks are carved out of one static
+// array, sized at build time from the limits below, so the RAM that messages take shows at link time. Messages
+// larger than the biggest block are refused (MessageTooBig) instead of allocated.
+// Only WSString storage is static. Each connection still takes heap when it opens: the WebsocketsClient and
+// its TcpClient, the callbacks' std::function, and with permessage-deflate its hash table. A server reserves
+// its connection lists once, for setMaxConnections() of them
+#ifdef _WS_CONFIG_STATIC_STRINGS
+  #define _WS_CONFIG_PAYLOAD_POOL
+  
+  #ifndef _WS_POOL_SIZE_CLASSES
+    // 32 B .. 1 KB
+    #define _WS_POOL_SIZE_CLASSES   6
+  #endif
+  
+  #ifndef _WS_POOL_STATIC_BLOCKS
+    // Blocks of each size class, each set of them costs _WS_POOL_MIN_BLOCK * (2^_WS_POOL_SIZE_CLASSES - 1) bytes,
+    // 2016 B by default
+    #if ( defined(__linux__) || defined(_WIN32) || defined(ESP32) || defined(ARDUINO_TEENSY41) || \
+          defined(ARDUINO_PORTENTA_H7_M7) )
+      // A frame being read and a message being assembled per connection, and two spare
+      #define _WS_POOL_STATIC_BLOCKS  (2 * _WS_SERVER_MAX_CONNECTIONS + 2)
+    #else
+      // Small boards (SAMD21: 32 KB of RAM): one connection, and two spare. About 8 KB
+      #define _WS_POOL_STATIC_BLOCKS  4
+    #endif
+  #endif
+  
+  #ifndef _WS_CONFIG_MAX_MESSAGE_SIZE
+    // Largest block, less the terminating zero
+    #define _WS_CONFIG_MAX_MESSAGE_SIZE   ((_WS_POOL_MIN_BLOCK << (_WS_POOL_SIZE_CLASSES - 1)) - 1)
+  #endif
+#endif
+#ifndef _WS_POOL_MIN_BLOCK
+  // Smallest block, each size class doubles it
+  #define _WS_POOL_MIN_BLOCK        32
+#endif
+
+#ifndef _WS_POOL_SIZE_CLASSES
+  // 32 B .. 4 KB by default. Larger requests go straight to the heap
+  #define _WS_POOL_SIZE_CLASSES     8
+#endif
+
+#ifndef _WS_POOL_FREE_BLOCKS
+  // Freed blocks kept for reuse per size class, the rest go back to the heap
+  #define _WS_POOL_FREE_BLOCKS      4
+#endif
+
 // KH, Common headers used for Client/Server
 
 #if !defined(WS_HEADERS_NORMAL_CASE)
@@ -53,6 +198,10 @@
   #define WS_KEY_LOWER_CASE                   "sec-websocket-key"
   
   #define WS_ACCEPT_NORMAL                    "Sec-WebSocket-Accept"
+  #define WS_ACCEPT_LOWER_CASE                "sec-websocket-accept"
+  
+  #define WS_EXTENSIONS_NORMAL                "Sec-WebSocket-Extensions"
+  #define WS_EXTENSIONS_LOWER_CASE            "sec-websocket-extensions"
   
   /////////////////////////////////////////////////////
 
@@ -73,6 +222,7 @@
   #define HEADER_ORIGIN_VALUE_NORMAL              "Origin: https://github.com/khoih-prog/Websockets2_Generic\r\n"
   
   #define HEADER_WS_ACCEPT_NORMAL                 "Sec-WebSocket-Accept: "
+  #define HEADER_WS_EXTENSIONS_NORMAL             "Sec-WebSocket-Extensions: "
   
   /////////////////////////////////////////////////////
   
@@ -41,12 +41,19 @@
 #include "Tiny_Websockets_Generic/server.hpp"
 
 // KH, from v1.0.1
+// _WS_CONFIG_DECLARATIONS_ONLY: the implementation is compiled once into a library (see extras/host),
+// every other translation unit only needs the declarations
+#ifndef _WS_CONFIG_DECLARATIONS_ONLY
 #include <WebSockets2_Generic_Client.hpp>
 #include <WebSockets2_Generic_Server.hpp>
 #include <WebSockets2_Generic_Message.hpp>
 #include <WebSockets2_Generic_Crypto.hpp>
 #include <WebSockets2_Generic_Endpoint.hpp>
 #include <WebSockets2_Generic_Common.hpp>
+#include <WebSockets2_Generic_Deflate.hpp>
+#include <WebSockets2_Generic_Handshake.hpp>
+#include <WebSockets2_Generic_Pool.hpp>
+#endif    // _WS_CONFIG_DECLARATIONS_ONLY
 //////
 
 #endif //_WEBSOCKETS2_GENERIC_H
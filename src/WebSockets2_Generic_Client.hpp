@@ -65,8 +65,14 @@ namespace websockets2_generic
     _connectionOpen(other._client->available()),
     _messagesCallback(other._messagesCallback),
     _eventsCallback(other._eventsCallback),
-    _sendMode(other._sendMode)
+    _payloadChunkCallback(other._payloadChunkCallback),
+    _sendMode(other._sendMode),
+    _connectState(other._connectState),
+    _connectFailReason(other._connectFailReason),
+    _target(other._target),
+    _reconnect(other._reconnect)
   {
+    _bindPayloadSink();
   
     // delete other's client
     const_cast<WebsocketsClient&>(other)._client = nullptr;
@@ -81,8 +87,14 @@ namespace websockets2_generic
     _connectionOpen(other._client->available()),
     _messagesCallback(other._messagesCallback),
     _eventsCallback(other._eventsCallback),
-    _sendMode(other._sendMode)
+    _payloadChunkCallback(other._payloadChunkCallback),
+    _sendMode(other._sendMode),
+    _connectState(other._connectState),
+    _connectFailReason(other._connectFailReason),
+    _target(other._target),
+    _reconnect(other._reconnect)
   {
+    _bindPayloadSink();
   
     // delete other's client
     const_cast<WebsocketsClient&>(other)._client = nullptr;
@@ -100,8 +112,15 @@ namespace websockets2_generic
     this->_client = other._client;
     this->_messagesCallback = other._messagesCallback;
     this->_eventsCallback = other._eventsCallback;
+    this->_payloadChunkCallback = other._payloadChunkCallback;
     this->_connectionOpen = other._connectionOpen;
     this->_sendMode = other._sendMode;
+    this->_connectState = other._connectState;
+    this->_connectFailReason = other._connectFailReason;
+    this->_target = other._target;
+    this->_reconnect = other._reconnect;
+    
+    _bindPayloadSink();
   
     // delete other's client
     const_cast<WebsocketsClient&>(other)._client = nullptr;
@@ -121,8 +140,15 @@ namespace websockets2_generic
     this->_client = other._client;
     this->_messagesCallback = other._messagesCallback;
     this->_eventsCallback = other._eventsCallback;
+    this->_payloadChunkCallback = other._payloadChunkCallback;
     this->_connectionOpen = other._connectionOpen;
     this->_sendMode = other._sendMode;
+    this->_connectState = other._connectState;
+    this->_connectFailReason = other._connectFailReason;
+    this->_target = other._target;
+    this->_reconnect = other._reconnect;
+    
+    _bindPayloadSink();
   
     // delete other's client
     const_cast<WebsocketsClient&>(other)._client = nullptr;
@@ -143,6 +169,9 @@ namespace websockets2_generic
       auth += ":";
       auth += password;
       base64Authorization = crypto2_generic::base64Encode((uint8_t *)auth.c_str(), auth.length());     
+      
+      // Rendered again on the next connect
+      this->_target.request = WSString();
     }
   }
   
@@ -155,156 +184,122 @@ namespace websockets2_generic
   
   /////////////////////////////////////////////////////////
   
-  struct HandshakeRequestResult
+  // Custom headers replacing one of the default ones
+  enum HandshakeHeader 
   {
-    WSString requestStr;
-    WSString expectedAcceptKey;
+    HandshakeHeader_Upgrade     = 0x01,
+    HandshakeHeader_Connection  = 0x02,
+    HandshakeHeader_Version     = 0x04,
+    HandshakeHeader_UserAgent   = 0x08,
+    HandshakeHeader_Origin      = 0x10,
+    HandshakeHeader_Extensions  = 0x20
   };
   
   /////////////////////////////////////////////////////////
   
-  bool shouldAddDefaultHeader(const std::string& keyWord, const std::vector<std::pair<WSString, WSString>>& customHeaders)
+  uint8_t customHandshakeHeaders(const std::vector<std::pair<WSString, WSString>>& customHeaders)
   {
+    uint8_t found = 0;
+    
     for (const auto& header : customHeaders)
     {
-      if (!keyWord.compare(header.first))
-      {
-        return false;
-      }
+      if (header.first == HEADER_UPGRADE_NORMAL)
+        found |= HandshakeHeader_Upgrade;
+      else if (header.first == HEADER_CONNECTION_NORMAL)
+        found |= HandshakeHeader_Connection;
+      else if (header.first == HEADER_WS_VERSION_NORMAL)
+        found |= HandshakeHeader_Version;
+      else if (header.first == HEADER_USER_AGENT_NORMAL)
+        found |= HandshakeHeader_UserAgent;
+      else if (header.first == HEADER_ORIGIN_NORMAL)
+        found |= HandshakeHeader_Origin;
+      else if (header.first == WS_EXTENSIONS_NORMAL)
+        found |= HandshakeHeader_Extensions;
     }
   
-    return true;
+    return found;
   }
   
   /////////////////////////////////////////////////////////
   
-  // KH 
-  HandshakeRequestResult generateHandshake(const WSString& host, const WSString& uri,
-      const std::vector<std::pair<WSString, WSString>>& customHeaders) 
+  // The whole upgrade request, with room for the Sec-WebSocket-Key value at `keyOffset`.
+  // Only the key changes from one connection to the next, see WebsocketsClient::renderHandshake()
+  WSString generateHandshakeTemplate(const WSString& host, const WSString& uri,
+      const std::vector<std::pair<WSString, WSString>>& customHeaders, const WSString& base64Authorization, size_t& keyOffset) 
   {
-    WSString key = crypto2_generic::base64Encode(crypto2_generic::randomBytes(16));
-  
-    WSString handshake = "GET " + uri + " HTTP/1.1\r\n";
-    handshake += HEADER_HOST + host + HEADER_HOST_RN;
-    handshake += HEADER_WS_KEY + key + HEADER_HOST_RN;
-  
+    const uint8_t custom = customHandshakeHeaders(customHeaders);
+    
+  #ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+    const WSString deflateOffer = (custom & HandshakeHeader_Extensions) ? WSString() : internals2_generic::deflateClientOffer();
+  #endif
+    
+    size_t size = 256 + uri.size() + host.size() + base64Authorization.size();
+    
     for (const auto& header : customHeaders)
     {
-      handshake += header.first + ": " + header.second + HEADER_HOST_RN;
+      size += header.first.size() + header.second.size() + 4;
     }
-  
-    if (shouldAddDefaultHeader(HEADER_UPGRADE_NORMAL, customHeaders))
-    {
-      handshake += HEADER_UPGRADE_WS;
-    }
-  
-    if (shouldAddDefaultHeader(HEADER_CONNECTION_NORMAL, customHeaders))
-    {
-      handshake += HEADER_CONNECTION_UPGRADE;
-    }
-  
-    if (shouldAddDefaultHeader(HEADER_WS_VERSION_NORMAL, customHeaders))
-    {
-      handshake += HEADER_WS_VERSION_13;
-    }
-  
-    if (shouldAddDefaultHeader(HEADER_USER_AGENT_NORMAL, customHeaders))
-    {
-      handshake += HEADER_USER_AGENT_VALUE;
-    }
-  
-    if (shouldAddDefaultHeader(HEADER_ORIGIN_NORMAL, customHeaders))
-    {
-      handshake += HEADER_ORIGIN_VALUE;
-    }
-  
-    handshake += HEADER_HOST_RN;
-  
-    HandshakeRequestResult result;
-    result.requestStr = handshake;
     
-
-    // KH
-    LOGINFO1("WebsocketsClient::generateHandshake: handshake =", internals2_generic::fromInternalString(handshake));
-    ////// 
-
-  
-  #ifndef _WS_CONFIG_SKIP_HANDSHAKE_ACCEPT_VALIDATION
-    result.expectedAcceptKey = crypto2_generic::websocketsHandshakeEncodeKey(key);
-  #endif
-  
-    // KH, Don't need return std::move(result);
-    return result;
-  }
-  
-  /////////////////////////////////////////////////////////
-  
-  HandshakeRequestResult generateHandshake(const WSString& host, const WSString& uri,
-      const std::vector<std::pair<WSString, WSString>>& customHeaders, const WSString& base64Authorization) 
-  {  
-    WSString key = crypto2_generic::base64Encode(crypto2_generic::randomBytes(16));
-  
-    WSString handshake = "GET " + uri + " HTTP/1.1\r\n";
-    handshake += HEADER_HOST + host + HEADER_HOST_RN;
-    handshake += HEADER_WS_KEY + key + HEADER_HOST_RN;
+    WSString handshake;
+    handshake.reserve(size);
+    
+    handshake += "GET ";
+    handshake += uri;
+    handshake += " HTTP/1.1\r\n" HEADER_HOST;
+    handshake += host;
+    handshake += HEADER_HOST_RN HEADER_WS_KEY;
+    
+    keyOffset = handshake.size();
+    
+    handshake.append(24, '=');
+    handshake += HEADER_HOST_RN;
   
     for (const auto& header : customHeaders)
     {
-      handshake += header.first + ": " + header.second + HEADER_HOST_RN;
+      handshake += header.first;
+      handshake += ": ";
+      handshake += header.second;
+      handshake += HEADER_HOST_RN;
     }
   
-    if (shouldAddDefaultHeader(HEADER_UPGRADE_NORMAL, customHeaders))
-    {
+    if (!(custom & HandshakeHeader_Upgrade))
       handshake += HEADER_UPGRADE_WS;
-    }
   
-    if (shouldAddDefaultHeader(HEADER_CONNECTION_NORMAL, customHeaders))
-    {
+    if (!(custom & HandshakeHeader_Connection))
       handshake += HEADER_CONNECTION_UPGRADE;
-    }
   
-    if (shouldAddDefaultHeader(HEADER_WS_VERSION_NORMAL, customHeaders))
-    {
+    if (!(custom & HandshakeHeader_Version))
       handshake += HEADER_WS_VERSION_13;
-    }
   
-    if (shouldAddDefaultHeader(HEADER_USER_AGENT_NORMAL, customHeaders))
-    {
+    if (!(custom & HandshakeHeader_UserAgent))
       handshake += HEADER_USER_AGENT_VALUE;
-    }
   
-    // KH
-    //if (WebsocketsClient::base64Authorization.size() > 0)
+    if (base64Authorization.size() > 0)
     {
       handshake += HEADER_AUTH_BASIC;  
-      handshake += base64Authorization + HEADER_HOST_RN;
-      
-      // KH
-      LOGINFO1("WebsocketsClient::generateHandshake: base64Authorization =", internals2_generic::fromInternalString(base64Authorization));
-      //////
+      handshake += base64Authorization;
+      handshake += HEADER_HOST_RN;
     }
 
-    if (shouldAddDefaultHeader(HEADER_ORIGIN_NORMAL, customHeaders))
-    {
+    if (!(custom & HandshakeHeader_Origin))
       handshake += HEADER_ORIGIN_VALUE;
+    
+  #ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+    if (!(custom & HandshakeHeader_Extensions))
+    {
+      handshake += HEADER_WS_EXTENSIONS_NORMAL;
+      handshake += deflateOffer;
+      handshake += HEADER_HOST_RN;
     }
-    //////
+  #endif
   
     handshake += HEADER_HOST_RN;
-  
-    HandshakeRequestResult result;
-    result.requestStr = handshake;
     
     // KH
-    LOGINFO1("WebsocketsClient::generateHandshake: handshake =", internals2_generic::fromInternalString(handshake));
+    LOGINFO1("WebsocketsClient::generateHandshakeTemplate: handshake =", internals2_generic::fromInternalString(handshake));
     ////// 
   
-  #ifndef _WS_CONFIG_SKIP_HANDSHAKE_ACCEPT_VALIDATION
-    result.expectedAcceptKey = crypto2_generic::websocketsHandshakeEncodeKey(key);
-  #endif
-  
-    // KH, Don't need return std::move(result);
-    return result;
+    return handshake;
   }
   
   /////////////////////////////////////////////////////////
@@ -316,73 +311,6 @@ namespace websockets2_generic
   
   /////////////////////////////////////////////////////////
 
-  struct HandshakeResponseResult
-  {
-    bool isSuccess;
-    WSString serverAccept;
-  };
-  
-  /////////////////////////////////////////////////////////
-
-  bool isCaseInsensetiveEqual(const WSString lhs, const WSString rhs)
-  {
-    if (lhs.size() != rhs.size())
-      return false;
-  
-    for (size_t i = 0; i < lhs.size(); i++)
-    {
-      char leftLowerCaseChar = lhs[i] >= 'A' && lhs[i] <= 'Z' ? lhs[i] - 'A' + 'a' : lhs[i];
-      char righerLowerCaseChar = rhs[i] >= 'A' && rhs[i] <= 'Z' ? rhs[i] - 'A' + 'a' : rhs[i];
-  
-      if (leftLowerCaseChar != righerLowerCaseChar)
-        return false;
-    }
-  
-    return true;
-  }
-  
-  /////////////////////////////////////////////////////////
-
-  HandshakeResponseResult parseHandshakeResponse(std::vector<WSString> responseHeaders)
-  {
-    bool didUpgradeToWebsockets = false, isConnectionUpgraded = false;
-    WSString serverAccept = "";
-  
-    for (WSString header : responseHeaders)
-    {
-      auto colonIndex = header.find_first_of(':');
-  
-      WSString key = header.substr(0, colonIndex);
-      WSString value = header.substr(colonIndex + 2); // +2 (ignore space and ':')
-      
-      // KH
-      LOGDEBUG1("WebsocketsClient::generateHandshake: key =", internals2_generic::fromInternalString(key));
-      LOGDEBUG1("WebsocketsClient::generateHandshake: value =", internals2_generic::fromInternalString(value));
-      ////// 
-  
-      if (isCaseInsensetiveEqual(key, HEADER_UPGRADE_LOWER_CASE))
-      {
-        didUpgradeToWebsockets = isCaseInsensetiveEqual(value, HEADER_WEBSOCKET_LOWER_CASE);
-      }
-      else if (isCaseInsensetiveEqual(key, HEADER_CONNECTION_LOWER_CASE))
-      {
-        isConnectionUpgraded = isCaseInsensetiveEqual(value, HEADER_UPGRADE_LOWER_CASE);
-      }
-      else if (isCaseInsensetiveEqual(key, WS_ACCEPT_NORMAL))
-      {
-        serverAccept = value;
-      }
-    }
-  
-    HandshakeResponseResult result;
-    result.isSuccess = serverAccept != "" && didUpgradeToWebsockets && isConnectionUpgraded;
-    result.serverAccept = serverAccept;
-  
-    return result;
-  }
-  
-  /////////////////////////////////////////////////////////
-
   bool doestStartsWith(WSString str, WSString prefix)
   {
     if (str.size() < prefix.size())
@@ -495,11 +423,12 @@ namespace websockets2_generic
   void WebsocketsClient::addHeader(const WSInterfaceString key, const WSInterfaceString value)
   {
     _customHeaders.push_back({internals2_generic::fromInterfaceString(key), internals2_generic::fromInterfaceString(value)});
+    this->_target.request = WSString();
   }
   
   /////////////////////////////////////////////////////////
 
-  bool WebsocketsClient::connect(WSInterfaceString _url)
+  bool WebsocketsClient::parseUrl(WSInterfaceString _url, WSString& host, int& port, WSString& path)
   {
     WSString url = internals2_generic::fromInterfaceString(_url);
     WSString protocol = "";
@@ -552,16 +481,17 @@ namespace websockets2_generic
     }
   
     auto uriBeg = url.find_first_of('/');
-    std::string host = url, uri = "/";
+    host = url;
+    path = "/";
   
     if (static_cast<int>(uriBeg) != -1)
     {
-      uri = url.substr(uriBeg);
+      path = url.substr(uriBeg);
       host = url.substr(0, uriBeg);
     }
   
     auto portIdx = host.find_first_of(':');
-    int port = defaultPort;
+    port = defaultPort;
   
     if (static_cast<int>(portIdx) != -1)
     {
@@ -577,11 +507,26 @@ namespace websockets2_generic
   
       host = onlyHost;
     }
+    
+    return true;
+  }
+  
+  /////////////////////////////////////////////////////////
+
+  bool WebsocketsClient::connect(WSInterfaceString _url)
+  {
+    WSString host, path;
+    int port;
+    
+    if (!parseUrl(_url, host, port, path))
+    {
+      return false;
+    }
   
     return this->connect(
              internals2_generic::fromInternalString(host),
              port,
-             internals2_generic::fromInternalString(uri)
+             internals2_generic::fromInternalString(path)
            );
   }
   
@@ -589,121 +534,401 @@ namespace websockets2_generic
 
   bool WebsocketsClient::connect(WSInterfaceString host, int port, WSInterfaceString path)
   {
-    // KH
-    LOGDEBUG("WebsocketsClient::connect: step 1");
-    //////
+    if (!connectAsync(host, port, path))
+    {
+      return false;
+    }
     
-    this->_connectionOpen = this->_client->connect(internals2_generic::fromInterfaceString(host), port);
-  
-    if (!this->_connectionOpen)
+    // Same steps as connectAsync(), waiting for them here
+    while (isConnecting())
     {
-      // KH
-      LOGDEBUG3("WebsocketsClient::connect: not _connectionOpen, host =", host, ", port =", port);
-      //////
+      advanceConnect();
+      yield();
+    }
     
+    return this->_connectionOpen;
+  }
+  
+  /////////////////////////////////////////////////////////
+
+  bool WebsocketsClient::connectAsync(WSInterfaceString _url)
+  {
+    WSString host, path;
+    int port;
+    
+    if (!parseUrl(_url, host, port, path))
+    {
       return false;
     }
   
+    return this->connectAsync(
+             internals2_generic::fromInternalString(host),
+             port,
+             internals2_generic::fromInternalString(path)
+           );
+  }
+  
+  /////////////////////////////////////////////////////////
+
+  bool WebsocketsClient::connectAsync(WSInterfaceString host, int port, WSInterfaceString path)
+  {
     // KH
-    //auto handshake = generateHandshake(internals2_generic::fromInterfaceString(host), internals2_generic::fromInterfaceString(path), _customHeaders);
-    
-    auto handshake = generateHandshake(internals2_generic::fromInterfaceString(host), 
-                        internals2_generic::fromInterfaceString(path), _customHeaders, base64Authorization);
-                        
-    LOGINFO1("WebsocketsClient::connect: base64Authorization =", internals2_generic::fromInternalString(base64Authorization));
+    LOGDEBUG("WebsocketsClient::connectAsync: step 1");
     //////
     
-    // KH
-    LOGDEBUG("WebsocketsClient::connect: step 2");
-    //////
+    WSString targetHost = internals2_generic::fromInterfaceString(host);
+    WSString targetPath = internals2_generic::fromInterfaceString(path);
     
-    this->_client->send(handshake.requestStr);
+    if (targetHost != this->_target.host || targetPath != this->_target.path)
+    {
+      this->_target = ConnectTarget();
+      this->_target.host = std::move(targetHost);
+      this->_target.path = std::move(targetPath);
+    }
     
-    // KH
-    LOGDEBUG("WebsocketsClient::connect: step 3");
-    //////
+    this->_target.port = port;
+    
+    this->_reconnect.armed      = true;
+    this->_reconnect.scheduled  = false;
+    this->_reconnect.attempts   = 0;
+    
+    return beginConnect();
+  }
   
-    // This check is needed because of an ESP32 lib bug that wont signal that the connection had
-    // failed in `->connect` (called above), sometimes the disconnect will only be noticed here (after a `send`)
-    if (!available())
+  /////////////////////////////////////////////////////////
+
+  void WebsocketsClient::renderHandshake()
+  {
+    if (this->_target.request.empty())
     {
-      return false;
+      // Once per target and configuration
+      this->_target.request = generateHandshakeTemplate(this->_target.host, this->_target.path, _customHeaders, 
+                                                        base64Authorization, this->_target.keyOffset);
     }
+    
+    char key[25];
+    crypto2_generic::websocketsHandshakeNewKey(key);
+    
+    memcpy(&this->_target.request[this->_target.keyOffset], key, 24);
+    
+  #ifndef _WS_CONFIG_SKIP_HANDSHAKE_ACCEPT_VALIDATION
+    char acceptKey[30];
+    crypto2_generic::websocketsHandshakeEncodeKey(key, acceptKey);
+    
+    this->_target.expectedAcceptKey = acceptKey;
+  #endif
+  }
   
-    auto head = this->_client->readLine();
+  /////////////////////////////////////////////////////////
+
+  // Starts an attempt at _target
+  bool WebsocketsClient::beginConnect()
+  {
+  #ifdef _WS_CONFIG_NO_TRUE_RANDOMNESS
+    // The key never changes, so neither does the request
+    if (this->_target.request.empty())
+  #endif
+    {
+      // A new key for each connection
+      renderHandshake();
+    }
     
-    // KH
-    LOGDEBUG("WebsocketsClient::connect: step 4");
-    //////
+    // Nothing of a previous connection carries over
+    this->_connectionOpen = false;
+    this->_connectFailReason = ConnectFailReason_None;
+    this->_endpoint.setInternalSocket(this->_client);
     
-    // KH
-    if (!doestStartsWith(head, "HTTP/1.1 101"))
-    //
+    this->_connectState = ConnectState();
+    this->_connectState.stage         = ConnectStage_TcpConnect;
+    this->_connectState.startedAt     = millis();
+    this->_connectState.usingAddress  = !this->_target.address.empty();
+    
+    this->_reconnect.attempted      = true;
+    this->_reconnect.lastAttemptAt  = this->_connectState.startedAt;
+    
+    const WSString& server = this->_connectState.usingAddress ? this->_target.address : this->_target.host;
+    
+    if (!this->_client->startConnect(server, this->_target.port))
     {
-      close(CloseReason_ProtocolError);
-      
       // KH
-      LOGERROR("WebsocketsClient::connect: CloseReason_ProtocolError");
+      LOGDEBUG3("WebsocketsClient::connectAsync: can't connect, host =", internals2_generic::fromInternalString(server), 
+                ", port =", this->_target.port);
       //////
-    
+      
+      failConnect(ConnectFailReason_TcpConnect, "TCP connect failed");
+      
       return false;
     }
+    
+    return true;
+  }
   
-    std::vector<WSString> serverResponseHeaders;
-    WSString line = "";
-  
-    // KH
-    LOGDEBUG("WebsocketsClient::connect: step 5");
-    //////
+  /////////////////////////////////////////////////////////
+
+  // One step of connectAsync(), never waits. Returns true once the connection is open
+  bool WebsocketsClient::advanceConnect()
+  {
+    if (millis() - this->_connectState.startedAt > _WS_CONNECT_TIMEOUT)
+    {
+      return failConnect(ConnectFailReason_Timeout, "Handshake timeout");
+    }
     
-    while (true)
+    if (this->_connectState.stage == ConnectStage_TcpConnect)
     {
-      line = this->_client->readLine();
-  
-      if (line.size() < 2)
+      auto progress = this->_client->connectProgress();
+      
+      if (progress == network2_generic::ConnectProgress_Pending)
       {
-        close(CloseReason_ProtocolError);
         return false;
       }
+      
+      if (progress == network2_generic::ConnectProgress_Failed)
+      {
+        return failConnect(ConnectFailReason_TcpConnect, "TCP connect failed");
+      }
+      
+      // KH
+      LOGDEBUG("WebsocketsClient::connectAsync: step 2");
+      //////
+      
+      if (!this->_client->send(this->_target.request))
+      {
+        return failConnect(ConnectFailReason_Closed, "Request not sent");
+      }
+      
+      this->_connectState.stage = ConnectStage_Response;
+    }
+    
+    // This check is needed because of an ESP32 lib bug that wont signal that the connection had
+    // failed in `->connect` (called above), sometimes the disconnect will only be noticed here (after a `send`)
+    if (!this->_client->available())
+    {
+      return failConnect(ConnectFailReason_Closed, "Connection closed");
+    }
+    
+    while (this->_client->poll())
+    {
+  #if (_WS_RX_BUFFER_SIZE > 0)
+      // Frames sent right behind the response go to the endpoint, so they must fit in its buffer
+      uint8_t buffer[_WS_RX_BUFFER_SIZE];
+  #else
+      uint8_t buffer[1];
+  #endif
   
-      if (line == HEADER_HOST_RN)
+      auto numRead = this->_client->read(buffer, sizeof(buffer));
+      
+      if (numRead == static_cast<uint32_t>(-1) || numRead == 0)
         break;
-  
-      // remove /r/n from line end
-      line = line.substr(0, line.size() - 2);
-  
-      serverResponseHeaders.push_back(line);
+      
+      size_t consumed;
+      auto result = this->_connectState.response.feed(reinterpret_cast<const char*>(buffer), numRead, consumed);
+      
+      if (result == internals2_generic::HandshakeResponseParser::Result_Error)
+      {
+        return failConnect(ConnectFailReason_BadResponse, "Response or its extensions too long");
+      }
+      
+      if (result == internals2_generic::HandshakeResponseParser::Result_Complete)
+      {
+        if (!this->_endpoint.preloadReceived(buffer + consumed, numRead - consumed))
+        {
+          return failConnect(ConnectFailReason_BadResponse, "Frames after the response lost");
+        }
+        
+        return finishConnect();
+      }
     }
     
+    return false;
+  }
+  
+  /////////////////////////////////////////////////////////
+
+  bool WebsocketsClient::finishConnect()
+  {
+    const auto& response = this->_connectState.response;
+    
     // KH
-    LOGDEBUG("WebsocketsClient::connect: step 6");
+    LOGDEBUG("WebsocketsClient::connectAsync: step 4");
     //////
-  
-    auto parsedResponse = parseHandshakeResponse(serverResponseHeaders);
+    
+    if (!response.isSwitchingProtocols())
+    {
+      // KH
+      LOGERROR("WebsocketsClient::connect: CloseReason_ProtocolError");
+      //////
+    
+      return failConnect(ConnectFailReason_BadResponse, "Not 101 Switching Protocols");
+    }
   
   #ifdef _WS_CONFIG_SKIP_HANDSHAKE_ACCEPT_VALIDATION
     bool serverAcceptMismatch = false;
   #else
-    bool serverAcceptMismatch = parsedResponse.serverAccept != handshake.expectedAcceptKey;
+    bool serverAcceptMismatch = strcmp(response.accept(), this->_target.expectedAcceptKey.c_str()) != 0;
   #endif
   
-    if (parsedResponse.isSuccess == false || serverAcceptMismatch)
+    bool isSuccess = (response.accept()[0] != '\0') && response.isUpgradeWebsocket() && response.isConnectionUpgrade();
+  
+    if (isSuccess == false || serverAcceptMismatch)
     {
       // KH
-      LOGERROR("WebsocketsClient::connect: parseHandshakeResponse not successful => CloseReason_ProtocolError");
+      LOGERROR("WebsocketsClient::connect: handshake response not successful => CloseReason_ProtocolError");
       //////
-      close(CloseReason_ProtocolError);
-      return false;
+      return failConnect(ConnectFailReason_BadResponse, "Bad handshake response");
     }
     
+  #ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+    internals2_generic::DeflateParams deflateParams;
+    
+    if (!internals2_generic::deflateParseResponse(response.extensions(), deflateParams))
+    {
+      LOGERROR1("WebsocketsClient::connect: bad Sec-WebSocket-Extensions =", response.extensions());
+      return failConnect(ConnectFailReason_BadResponse, "Bad Sec-WebSocket-Extensions");
+    }
+    
+    this->_endpoint.setDeflate(deflateParams, false);
+  #endif
+  
     // KH
-    LOGDEBUG("WebsocketsClient::connect: step 7");
+    LOGDEBUG("WebsocketsClient::connectAsync: step 7");
     //////
+    
+    this->_connectState = ConnectState();
+    this->_connectionOpen = true;
+    
+    // Reconnects go straight to this address
+    this->_target.address     = this->_client->getRemoteAddress();
+    this->_reconnect.attempts = 0;
   
     this->_eventsCallback(*this, WebsocketsEvent::ConnectionOpened, {});
     return true;
   }
   
+  /////////////////////////////////////////////////////////
+
+  bool WebsocketsClient::failConnect(const ConnectFailReason reason, const char* description)
+  {
+    if (this->_connectState.usingAddress && reason != ConnectFailReason_BadResponse)
+    {
+      // The server may have moved, resolve its name again next time
+      this->_target.address = "";
+    }
+    
+    this->_connectState = ConnectState();
+    this->_connectFailReason = reason;
+    this->_connectionOpen = false;
+    
+    if (reason == ConnectFailReason_BadResponse)
+    {
+      // Tell the server why, as connect() always did
+      this->_endpoint.close(CloseReason_ProtocolError);
+    }
+    else
+    {
+      this->_client->close();
+    }
+    
+    this->_eventsCallback(*this, WebsocketsEvent::ConnectionFailed, description);
+    return false;
+  }
+  
+  /////////////////////////////////////////////////////////
+
+  void WebsocketsClient::setReconnect(const ReconnectPolicy& policy)
+  {
+    this->_reconnect.policy   = policy;
+    this->_reconnect.enabled  = true;
+    
+    // Past 100%, the random offset could exceed the delay and wrap it around
+    if (this->_reconnect.policy.jitter > 100)
+    {
+      this->_reconnect.policy.jitter = 100;
+    }
+  }
+  
+  /////////////////////////////////////////////////////////
+
+  void WebsocketsClient::disableReconnect()
+  {
+    this->_reconnect.enabled    = false;
+    this->_reconnect.scheduled  = false;
+  }
+  
+  /////////////////////////////////////////////////////////
+
+  void WebsocketsClient::advanceReconnect()
+  {
+    if (!this->_reconnect.armed || this->_target.host.empty())
+    {
+      return;
+    }
+    
+    if (!this->_reconnect.scheduled)
+    {
+      this->_reconnect.delay        = reconnectDelay();
+      this->_reconnect.scheduledAt  = millis();
+      this->_reconnect.scheduled    = true;
+      
+      LOGINFO1("WebsocketsClient::advanceReconnect: next attempt in ms =", this->_reconnect.delay);
+      
+      return;
+    }
+    
+    if (millis() - this->_reconnect.scheduledAt < this->_reconnect.delay)
+    {
+      return;
+    }
+    
+    this->_reconnect.scheduled = false;
+    
+    if (this->_reconnect.attempts < 255)
+    {
+      this->_reconnect.attempts++;
+    }
+    
+    beginConnect();
+  }
+  
+  /////////////////////////////////////////////////////////
+
+  uint32_t WebsocketsClient::reconnectDelay()
+  {
+    const ReconnectPolicy& policy = this->_reconnect.policy;
+    
+    uint32_t delay = policy.minDelay;
+    
+    // Doubles with every failed attempt
+    for (uint8_t i = 0; i < this->_reconnect.attempts && delay < policy.maxDelay; i++)
+    {
+      delay *= 2;
+    }
+    
+    if (delay > policy.maxDelay)
+    {
+      delay = policy.maxDelay;
+    }
+    
+    if (policy.jitter > 0)
+    {
+      long spread = static_cast<long>(delay / 100 * policy.jitter);
+      
+      delay += random(-spread, spread + 1);
+    }
+    
+    if (this->_reconnect.attempted)
+    {
+      // Caps the attempt rate, however small the delays are set
+      uint32_t elapsed = millis() - this->_reconnect.lastAttemptAt;
+      
+      if (elapsed + delay < policy.minInterval)
+      {
+        delay = policy.minInterval - elapsed;
+      }
+    }
+    
+    return delay;
+  }
+  
   /////////////////////////////////////////////////////////
   
   bool WebsocketsClient::connectSecure(WSInterfaceString host, int port, WSInterfaceString path) 
@@ -726,7 +951,7 @@ namespace websockets2_generic
   {
     this->_messagesCallback = [callback](WebsocketsClient&, WebsocketsMessage msg)
     {
-      callback(msg);
+      callback(std::move(msg));
     };
   }
   
@@ -749,10 +974,83 @@ namespace websockets2_generic
   
   /////////////////////////////////////////////////////////
 
+  void WebsocketsClient::onPayloadChunk(PayloadChunkCallback callback)
+  {
+    this->_payloadChunkCallback = callback;
+    _bindPayloadSink();
+  }
+  
+  /////////////////////////////////////////////////////////
+
+  void WebsocketsClient::onPayloadChunk(PartialPayloadChunkCallback callback)
+  {
+    if (!callback)
+    {
+      onPayloadChunk(PayloadChunkCallback());
+      return;
+    }
+    
+    onPayloadChunk([callback](WebsocketsClient&, const WebsocketsPayloadChunk& chunk)
+    {
+      callback(chunk);
+    });
+  }
+  
+  /////////////////////////////////////////////////////////
+
+  // The endpoint's sink refers back to this client, so it is re-bound whenever the client is copied
+  void WebsocketsClient::_bindPayloadSink()
+  {
+    if (!this->_payloadChunkCallback)
+    {
+      this->_endpoint.setPayloadSink(nullptr);
+      return;
+    }
+    
+    this->_endpoint.setPayloadSink([this](const WebsocketsPayloadChunk& chunk)
+    {
+      this->_payloadChunkCallback(*this, chunk);
+    });
+  }
+  
+  /////////////////////////////////////////////////////////
+
   bool WebsocketsClient::poll()
   {
+    return _poll(static_cast<size_t>(-1));
+  }
+  
+  /////////////////////////////////////////////////////////
+
+  bool WebsocketsClient::_poll(const size_t maxMessages)
+  {
+    unsigned long start = micros();
+    bool messageReceived = _pollMessages(maxMessages);
+    
+    _endpoint.stats().pollTime += micros() - start;
+    
+    return messageReceived;
+  }
+  
+  /////////////////////////////////////////////////////////
+
+  bool WebsocketsClient::_pollMessages(const size_t maxMessages)
+  {
+    if (isConnecting())
+    {
+      if (!advanceConnect())
+        return false;
+    }
+    else if (!this->_connectionOpen && this->_reconnect.enabled)
+    {
+      advanceReconnect();
+      return false;
+    }
+    
     bool messageReceived = false;
-    while (available() && _endpoint.poll())
+    size_t handled = 0;
+    
+    while (handled < maxMessages && available() && _endpoint.poll())
     {
       auto msg = _endpoint.recv();
   
@@ -762,6 +1060,9 @@ namespace websockets2_generic
       }
   
       messageReceived = true;
+      handled++;
+      
+      unsigned long callbackStart = micros();
   
       if (msg.isBinary() || msg.isText())
       {
@@ -785,6 +1086,8 @@ namespace websockets2_generic
         this->_connectionOpen = false;
         _handleClose(std::move(msg));
       }
+      
+      _endpoint.stats().callbackTime += micros() - callbackStart;
     }
   
     return messageReceived;
@@ -819,20 +1122,36 @@ namespace websockets2_generic
     return {};
   }
   
+  /////////////////////////////////////////////////////////
+  
+  WebsocketsPayloadInfo WebsocketsClient::readInto(char* buffer, const size_t capacity)
+  {
+    if (!available() || !_endpoint.poll())
+      return {};
+      
+    auto info = _endpoint.recvInto(buffer, capacity);
+    
+    if (info.type == MessageType::Close)
+    {
+      this->_connectionOpen = false;
+      _handleClose(WebsocketsMessage(info.type, WSString(buffer, info.length)));
+    }
+    
+    return info;
+  }
+  
   /////////////////////////////////////////////////////////
 
   bool WebsocketsClient::send(const WSInterfaceString& data)
   {
-    auto str = internals2_generic::fromInterfaceString(data);
-    return this->send(str.c_str(), str.size());
+    return this->send(data.c_str(), data.length());
   }
   
   /////////////////////////////////////////////////////////
 
   bool WebsocketsClient::send(const WSInterfaceString&& data)
   {
-    auto str = internals2_generic::fromInterfaceString(data);
-    return this->send(str.c_str(), str.size());
+    return this->send(data.c_str(), data.length());
   }
   
   /////////////////////////////////////////////////////////
@@ -872,15 +1191,14 @@ namespace websockets2_generic
       }
     }
     
-    return false;
+    return _sendFailed();
   }
   
   /////////////////////////////////////////////////////////
 
-  bool WebsocketsClient::sendBinary(WSInterfaceString data)
+  bool WebsocketsClient::sendBinary(const WSInterfaceString& data)
   {
-    auto str = internals2_generic::fromInterfaceString(data);
-    return this->sendBinary(str.c_str(), str.size());
+    return this->sendBinary(data.c_str(), data.length());
   }
   
   /////////////////////////////////////////////////////////
@@ -912,55 +1230,79 @@ namespace websockets2_generic
                );
       }
     }
-    return false;
+    return _sendFailed();
   }
   
   /////////////////////////////////////////////////////////
 
-  bool WebsocketsClient::stream(const WSInterfaceString data)
+  bool WebsocketsClient::stream(const WSInterfaceString& data)
+  {
+    return this->stream(data.c_str(), data.length());
+  }
+  
+  /////////////////////////////////////////////////////////
+
+  bool WebsocketsClient::stream(const char* data, const size_t len)
   {
     if (available() && this->_sendMode == SendMode_Normal)
     {
       this->_sendMode = SendMode_Streaming;
       return _endpoint.send(
-               internals2_generic::fromInterfaceString(data),
+               data,
+               len,
                internals2_generic::ContentType::Text,
                false
              );
     }
-    return false;
+    return _sendFailed();
   }
   
   /////////////////////////////////////////////////////////
 
-  bool WebsocketsClient::streamBinary(const WSInterfaceString data)
+  bool WebsocketsClient::streamBinary(const WSInterfaceString& data)
+  {
+    return this->streamBinary(data.c_str(), data.length());
+  }
+  
+  /////////////////////////////////////////////////////////
+
+  bool WebsocketsClient::streamBinary(const char* data, const size_t len)
   {
     if (available() && this->_sendMode == SendMode_Normal)
     {
       this->_sendMode = SendMode_Streaming;
       return _endpoint.send(
-               internals2_generic::fromInterfaceString(data),
+               data,
+               len,
                internals2_generic::ContentType::Binary,
                false
              );
     }
-    return false;
+    return _sendFailed();
+  }
+  
+  /////////////////////////////////////////////////////////
+
+  bool WebsocketsClient::end(const WSInterfaceString& data)
+  {
+    return this->end(data.c_str(), data.length());
   }
   
   /////////////////////////////////////////////////////////
 
-  bool WebsocketsClient::end(const WSInterfaceString data)
+  bool WebsocketsClient::end(const char* data, const size_t len)
   {
     if (available() && this->_sendMode == SendMode_Streaming)
     {
       this->_sendMode = SendMode_Normal;
       return _endpoint.send(
-               internals2_generic::fromInterfaceString(data),
+               data,
+               len,
                internals2_generic::ContentType::Continuation,
                true
              );
     }
-    return false;
+    return _sendFailed();
   }
   
   /////////////////////////////////////////////////////////
@@ -976,7 +1318,7 @@ namespace websockets2_generic
   {
     if (activeTest)  
     {
-      _endpoint.ping("");
+      _endpoint.ping("", 0);
     }
   
     bool updatedConnectionOpen = this->_connectionOpen && this->_client && this->_client->available();
@@ -994,32 +1336,56 @@ namespace websockets2_generic
   
   /////////////////////////////////////////////////////////
 
-  bool WebsocketsClient::ping(const WSInterfaceString data)
+  bool WebsocketsClient::ping(const WSInterfaceString& data)
+  {
+    return this->ping(data.c_str(), data.length());
+  }
+  
+  /////////////////////////////////////////////////////////
+
+  bool WebsocketsClient::ping(const char* data, const size_t len)
   {
     if (available())
     {
-      return _endpoint.ping(internals2_generic::fromInterfaceString(data));
+      return _endpoint.ping(data, len);
     }
   
-    return false;
+    return _sendFailed();
   }
   
   /////////////////////////////////////////////////////////
 
-  bool WebsocketsClient::pong(const WSInterfaceString data)
+  bool WebsocketsClient::pong(const WSInterfaceString& data)
+  {
+    return this->pong(data.c_str(), data.length());
+  }
+  
+  /////////////////////////////////////////////////////////
+
+  bool WebsocketsClient::pong(const char* data, const size_t len)
   {
     if (available())
     {
-      return _endpoint.pong(internals2_generic::fromInterfaceString(data));
+      return _endpoint.pong(data, len);
     }
   
-    return false;
+    return _sendFailed();
   }
   
   /////////////////////////////////////////////////////////
 
   void WebsocketsClient::close(const CloseReason reason)
   {
+    // Closed on purpose, don't come back
+    this->_reconnect.armed      = false;
+    this->_reconnect.scheduled  = false;
+    
+    if (isConnecting())
+    {
+      this->_connectState = ConnectState();
+      this->_client->close();
+    }
+    
     if (available())
     {
       this->_connectionOpen = false;
@@ -1037,6 +1403,15 @@ namespace websockets2_generic
   
   /////////////////////////////////////////////////////////
 
+  bool WebsocketsClient::_sendFailed()
+  {
+    _endpoint.stats().failedSends++;
+    
+    return false;
+  }
+  
+  /////////////////////////////////////////////////////////
+
   void WebsocketsClient::_handlePing(const WebsocketsMessage message)
   {
     this->_eventsCallback(*this, WebsocketsEvent::GotPing, message.data());
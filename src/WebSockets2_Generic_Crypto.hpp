@@ -59,29 +59,29 @@ namespace websockets2_generic
     WSString websocketsHandshakeEncodeKey(WSString key)
     {
       char base64[30];
-      internals2_generic::sha1(key.c_str())
+      websocketsHandshakeEncodeKey(key.c_str(), base64);
+    
+      return WSString(base64);
+    }
+    
+    void websocketsHandshakeEncodeKey(const char* key, char (&base64)[30])
+    {
+      internals2_generic::sha1(key)
       .add("258EAFA5-E914-47DA-95CA-C5AB0DC85B11")
       .finalize()
       .print_base64(base64);
-    
-      return WSString(base64);
     }
     
     #ifdef _WS_CONFIG_NO_TRUE_RANDOMNESS
-    WSString randomBytes(size_t len)
+    static void randomBytes(uint8_t* result, size_t len)
     {
-      WSString result;
-      result.reserve(len);
-    
       for (size_t i = 0; i < len; i++)
       {
-        result += "0123456789abcdef"[i % 16];
+        result[i] = "0123456789abcdef"[i % 16];
       }
-    
-      return result;
     }
     #else
-    WSString randomBytes(size_t len)
+    static void randomBytes(uint8_t* result, size_t len)
     {
       static int onlyOnce = []()
       {
@@ -89,17 +89,29 @@ namespace websockets2_generic
         return 0;
       }();
     
-      WSString result;
-      result.reserve(len);
-    
       for (size_t i = onlyOnce; i < len; i++)
       {
-        result += "0123456789abcdefABCDEFGHIJKLMNOPQRSTUVEXYZ"[rand() % 42];
+        result[i] = "0123456789abcdefABCDEFGHIJKLMNOPQRSTUVEXYZ"[rand() % 42];
       }
+    }
+    #endif
+    
+    WSString randomBytes(size_t len)
+    {
+      WSString result(len, '\0');
+      randomBytes(reinterpret_cast<uint8_t*>(&result[0]), len);
     
       return result;
     }
-    #endif
+    
+    void websocketsHandshakeNewKey(char (&key)[25])
+    {
+      uint8_t bytes[16];
+      randomBytes(bytes, sizeof(bytes));
+      
+      internals2_generic::base64_encode(bytes, sizeof(bytes), key);
+      key[24] = '\0';
+    }
   }   // namespace crypto2_generic
 }     // namespace websockets2_generic
 
@@ -0,0 +1,895 @@
+/****************************************************************************************************************************
+  WebSockets2_Generic_Deflate.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+
+#ifndef _WEBSOCKETS2_GENERIC_DEFLATE_H
+#define _WEBSOCKETS2_GENERIC_DEFLATE_H
+
+#pragma once
+
+// KH
+#include <WebSockets2_Generic.h>
+
+#include <Tiny_Websockets_Generic/internals/ws_deflate.hpp>
+#include <string.h>
+
+#ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+
+namespace websockets2_generic
+{
+  namespace internals2_generic
+  {
+    /////////////////////////////////////////////////////////
+    
+    // Extension negotiation
+    
+    struct DeflateElement
+    {
+      bool    valid                   = false;
+      bool    serverNoContextTakeover = false;
+      bool    clientNoContextTakeover = false;
+      uint8_t serverMaxWindowBits     = 0;      // 0 if not present
+      uint8_t clientMaxWindowBits     = 0;      // 0 if not present
+    };
+    
+    /////////////////////////////////////////////////////////
+    
+    // Negotiation parses the header where it is: tokens are [first, last) ranges of it, nothing is copied
+    
+    // Strips blanks, and the quotes parameter values may have
+    void deflateTrim(const char*& first, const char*& last)
+    {
+      while (first < last && (*first == ' ' || *first == '\t')) 
+        first++;
+        
+      while (last > first && (last[-1] == ' ' || last[-1] == '\t')) 
+        last--;
+      
+      if (last - first >= 2 && *first == '"' && last[-1] == '"') 
+      {
+        first++;
+        last--;
+      }
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    // Case-insensitive, `name` is lowercase
+    bool deflateTokenIs(const char* first, const char* last, const char* name)
+    {
+      deflateTrim(first, last);
+      
+      for (; first < last; first++, name++) 
+      {
+        char ch = (*first >= 'A' && *first <= 'Z') ? *first - 'A' + 'a' : *first;
+        
+        if (*name == '\0' || ch != *name) 
+          return false;
+      }
+      
+      return *name == '\0';
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    // Position of `separator`, `last` if there is none
+    const char* deflateFind(const char* first, const char* last, const char separator)
+    {
+      while (first < last && *first != separator) 
+        first++;
+        
+      return first;
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    // Window bits are 8 to 15, returns 0 if the value isn't one of them
+    uint8_t deflateWindowBits(const char* first, const char* last)
+    {
+      deflateTrim(first, last);
+      
+      if (first == last || last - first > 2) 
+        return 0;
+        
+      uint8_t bits = 0;
+      
+      for (; first < last; first++) 
+      {
+        if (*first < '0' || *first > '9') 
+          return 0;
+          
+        bits = bits * 10 + (*first - '0');
+      }
+      
+      return (bits >= 8 && bits <= 15) ? bits : 0;
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    WSString deflateWindowBitsString(const uint8_t bits)
+    {
+      WSString str;
+      
+      if (bits >= 10) 
+        str += '1';
+        
+      str += static_cast<char>('0' + bits % 10);
+      
+      return str;
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    // Parses "permessage-deflate; param; param=value". `isOffer` allows client_max_window_bits without value
+    DeflateElement parseDeflateElement(const char* first, const char* last, const bool isOffer)
+    {
+      DeflateElement result;
+      const char* end = deflateFind(first, last, ';');
+      
+      if (!deflateTokenIs(first, end, "permessage-deflate")) 
+        return result;
+      
+      while (end < last) 
+      {
+        first = end + 1;
+        end = deflateFind(first, last, ';');
+        
+        const char* equals = deflateFind(first, end, '=');
+        bool hasValue = equals < end;
+        
+        if (deflateTokenIs(first, equals, "server_no_context_takeover") && !hasValue && !result.serverNoContextTakeover) 
+        {
+          result.serverNoContextTakeover = true;
+        } 
+        else if (deflateTokenIs(first, equals, "client_no_context_takeover") && !hasValue && !result.clientNoContextTakeover) 
+        {
+          result.clientNoContextTakeover = true;
+        } 
+        else if (deflateTokenIs(first, equals, "server_max_window_bits") && hasValue && result.serverMaxWindowBits == 0) 
+        {
+          result.serverMaxWindowBits = deflateWindowBits(equals + 1, end);
+          
+          if (result.serverMaxWindowBits == 0) 
+            return result;
+        } 
+        else if (deflateTokenIs(first, equals, "client_max_window_bits") && result.clientMaxWindowBits == 0 && 
+                 (hasValue || isOffer)) 
+        {
+          result.clientMaxWindowBits = hasValue ? deflateWindowBits(equals + 1, end) : 15;
+          
+          if (result.clientMaxWindowBits == 0) 
+            return result;
+        } 
+        else 
+        {
+          // Unknown or duplicated parameter, or bad value
+          return result;
+        }
+      }
+      
+      result.valid = true;
+      
+      return result;
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    WSString deflateClientOffer()
+    {
+      // Either the server doesn't keep context between messages, or it keeps it within a window
+      // small enough for us to hold on to
+      return WSString("permessage-deflate; server_no_context_takeover; client_max_window_bits, ") + 
+             "permessage-deflate; server_max_window_bits=" + deflateWindowBitsString(_WS_DEFLATE_WINDOW_BITS) + 
+             "; client_max_window_bits";
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    bool deflateParseResponse(const char* header, DeflateParams& params)
+    {
+      params = DeflateParams();
+      
+      const char* last = header + strlen(header);
+      
+      if (deflateTokenIs(header, last, "")) 
+        return true;
+        
+      // A single element, the server can't accept both offers
+      if (deflateFind(header, last, ',') != last) 
+        return false;
+        
+      auto element = parseDeflateElement(header, last, false);
+      
+      if (!element.valid) 
+        return false;
+        
+      if (!element.serverNoContextTakeover && 
+          (element.serverMaxWindowBits == 0 || element.serverMaxWindowBits > _WS_DEFLATE_WINDOW_BITS)) 
+      {
+        // Not what either of our offers asked for
+        return false;
+      }
+      
+      params.enabled                  = true;
+      params.serverNoContextTakeover  = element.serverNoContextTakeover;
+      params.clientNoContextTakeover  = element.clientNoContextTakeover;
+      params.serverMaxWindowBits      = element.serverMaxWindowBits ? element.serverMaxWindowBits : 15;
+      params.clientMaxWindowBits      = element.clientMaxWindowBits ? element.clientMaxWindowBits : 15;
+      
+      return true;
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    bool deflateAcceptOffer(const char* header, DeflateParams& params, WSString& response)
+    {
+      params = DeflateParams();
+      response = "";
+      
+      const char* last = header + strlen(header);
+      
+      // Offers in order of preference, separated by commas
+      for (const char* first = header, *end = header; end < last; first = end + 1) 
+      {
+        end = deflateFind(first, last, ',');
+        
+        auto element = parseDeflateElement(first, end, true);
+        
+        if (!element.valid) 
+          continue;
+        
+        params.enabled                  = true;
+        params.serverNoContextTakeover  = element.serverNoContextTakeover;
+        
+        // Always asked of the client, so we never have to keep its history
+        params.clientNoContextTakeover  = true;
+        params.serverMaxWindowBits      = element.serverMaxWindowBits ? element.serverMaxWindowBits : 15;
+        params.clientMaxWindowBits      = element.clientMaxWindowBits ? element.clientMaxWindowBits : 15;
+        
+        if (params.serverMaxWindowBits > _WS_DEFLATE_WINDOW_BITS) 
+          params.serverMaxWindowBits = _WS_DEFLATE_WINDOW_BITS;
+        
+        response = "permessage-deflate; client_no_context_takeover";
+        
+        if (element.serverNoContextTakeover) 
+          response += "; server_no_context_takeover";
+          
+        if (element.serverMaxWindowBits) 
+          response += "; server_max_window_bits=" + deflateWindowBitsString(params.serverMaxWindowBits);
+          
+        return true;
+      }
+      
+      return false;
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    // Tables of RFC 1951, 3.2.5
+    
+    const uint16_t DEFLATE_LENGTH_BASE[29]  = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                                35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const uint8_t  DEFLATE_LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                                3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const uint16_t DEFLATE_DIST_BASE[30]    = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                                257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                                8193, 12289, 16385, 24577 };
+    const uint8_t  DEFLATE_DIST_EXTRA[30]   = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                                7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    
+    /////////////////////////////////////////////////////////
+    
+    // Compressor: greedy LZ77 on a single-entry hash table, fixed Huffman codes. Much lighter than zlib,
+    // and it does well enough on the repetitive text (JSON) this is meant for
+    
+    struct DeflateBitWriter
+    {
+      WSString& out;
+      uint32_t  bitBuffer = 0;
+      uint8_t   bitCount  = 0;
+      
+      DeflateBitWriter(WSString& output) : out(output) {}
+      
+      // Bits go out least significant first
+      void put(const uint32_t value, const uint8_t count)
+      {
+        bitBuffer |= value << bitCount;
+        bitCount += count;
+        
+        while (bitCount >= 8) 
+        {
+          out += static_cast<char>(bitBuffer & 0xFF);
+          bitBuffer >>= 8;
+          bitCount -= 8;
+        }
+      }
+      
+      // ... except Huffman codes, most significant first
+      void putCode(uint32_t code, const uint8_t count)
+      {
+        uint32_t reversed = 0;
+        
+        for (uint8_t i = 0; i < count; i++) 
+        {
+          reversed = (reversed << 1) | (code & 1);
+          code >>= 1;
+        }
+        
+        put(reversed, count);
+      }
+      
+      void putLiteral(const uint16_t symbol)
+      {
+        if (symbol < 144)
+          putCode(0x30 + symbol, 8);
+        else if (symbol < 256)
+          putCode(0x190 + symbol - 144, 9);
+        else if (symbol < 280)
+          putCode(symbol - 256, 7);
+        else
+          putCode(0xC0 + symbol - 280, 8);
+      }
+      
+      void putMatch(const uint16_t length, const uint16_t distance)
+      {
+        uint8_t code = 28;
+        
+        while (DEFLATE_LENGTH_BASE[code] > length) 
+          code--;
+          
+        putLiteral(257 + code);
+        put(length - DEFLATE_LENGTH_BASE[code], DEFLATE_LENGTH_EXTRA[code]);
+        
+        code = 29;
+        
+        while (DEFLATE_DIST_BASE[code] > distance) 
+          code--;
+          
+        putCode(code, 5);
+        put(distance - DEFLATE_DIST_BASE[code], DEFLATE_DIST_EXTRA[code]);
+      }
+      
+      void flush()
+      {
+        if (bitCount > 0) 
+        {
+          out += static_cast<char>(bitBuffer & 0xFF);
+          bitBuffer = 0;
+          bitCount = 0;
+        }
+      }
+    };
+    
+    /////////////////////////////////////////////////////////
+    
+    uint32_t deflateHash(const uint8_t* data)
+    {
+      uint32_t value = (static_cast<uint32_t>(data[0]) << 16) | (static_cast<uint32_t>(data[1]) << 8) | data[2];
+      
+      return static_cast<uint32_t>(value * 2654435761UL) >> (32 - _WS_DEFLATE_HASH_BITS);
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    PerMessageDeflate::PerMessageDeflate(const DeflateParams& params, const bool isServer) :
+      _sendWindowBits(isServer ? params.serverMaxWindowBits : params.clientMaxWindowBits),
+      _recvWindowBits(isServer ? params.clientMaxWindowBits : params.serverMaxWindowBits),
+      _recvContextTakeover(!(isServer ? params.clientNoContextTakeover : params.serverNoContextTakeover)),
+      _threshold(_WS_DEFLATE_THRESHOLD),
+      _hashTable(new uint16_t[1 << _WS_DEFLATE_HASH_BITS])
+    {
+      if (this->_sendWindowBits > _WS_DEFLATE_WINDOW_BITS)
+        this->_sendWindowBits = _WS_DEFLATE_WINDOW_BITS;
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    bool PerMessageDeflate::compress(const uint8_t* data, const size_t len, WSString& out)
+    {
+      if (len < this->_threshold || len < 8) 
+        return false;
+        
+      out.clear();
+      out.reserve(len);
+      
+      DeflateBitWriter writer(out);
+      
+      // Not the final block (the message ends with a sync flush), fixed Huffman codes
+      writer.put(0, 1);
+      writer.put(1, 2);
+      
+      // Positions are stored modulo 64K, which is plenty for windows of at most 32K
+      uint16_t* table = this->_hashTable.get();
+      memset(table, 0, sizeof(uint16_t) << _WS_DEFLATE_HASH_BITS);
+      
+      const size_t window = static_cast<size_t>(1) << this->_sendWindowBits;
+      size_t pos = 0;
+      
+      while (pos < len) 
+      {
+        size_t matchLength = 0;
+        size_t distance = 0;
+        
+        if (pos + 3 <= len) 
+        {
+          uint32_t hash = deflateHash(data + pos);
+          
+          distance = (pos - table[hash]) & 0xFFFF;
+          table[hash] = static_cast<uint16_t>(pos);
+          
+          // The table entry is only a guess, the bytes are compared anyway
+          if (distance > 0 && distance <= pos && distance < window) 
+          {
+            const uint8_t* candidate = data + pos - distance;
+            size_t maxLength = (len - pos) < 258 ? (len - pos) : 258;
+            
+            while (matchLength < maxLength && candidate[matchLength] == data[pos + matchLength]) 
+              matchLength++;
+          }
+        }
+        
+        if (matchLength >= 3) 
+        {
+          writer.putMatch(matchLength, distance);
+          
+          // Index what the match covered, later data may refer to it
+          for (size_t i = 1; i < matchLength && pos + i + 3 <= len; i++) 
+          {
+            table[deflateHash(data + pos + i)] = static_cast<uint16_t>(pos + i);
+          }
+          
+          pos += matchLength;
+        } 
+        else 
+        {
+          writer.putLiteral(data[pos]);
+          pos++;
+        }
+        
+        if (out.size() >= len) 
+        {
+          // Not worth it, give up early
+          return false;
+        }
+      }
+      
+      // End of block, then the sync flush: an empty stored block. Its 00 00 ff ff (what follows the
+      // byte alignment) is left out, as RFC 7692 asks
+      writer.putLiteral(256);
+      writer.put(0, 3);
+      writer.flush();
+      
+      return out.size() < len;
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    // Decompressor, a small canonical Huffman decoder in the spirit of zlib's puff.c
+    
+    struct DeflateBitReader
+    {
+      const uint8_t*  data;
+      size_t          len;
+      size_t          pos       = 0;
+      uint32_t        bitBuffer = 0;
+      uint8_t         bitCount  = 0;
+      bool            overrun   = false;
+      
+      DeflateBitReader(const uint8_t* input, const size_t length) : data(input), len(length) {}
+      
+      // The 00 00 ff ff the sender removed is fed back after the data
+      uint8_t nextByte()
+      {
+        static const uint8_t tail[4] = { 0x00, 0x00, 0xFF, 0xFF };
+        
+        if (pos < len)
+          return data[pos++];
+          
+        if (pos < len + 4)
+          return tail[pos++ - len];
+          
+        overrun = true;
+        
+        return 0;
+      }
+      
+      uint32_t bits(const uint8_t count)
+      {
+        while (bitCount < count) 
+        {
+          bitBuffer |= static_cast<uint32_t>(nextByte()) << bitCount;
+          bitCount += 8;
+        }
+        
+        uint32_t value = bitBuffer & ((1UL << count) - 1);
+        
+        bitBuffer >>= count;
+        bitCount -= count;
+        
+        return value;
+      }
+      
+      void alignToByte()
+      {
+        bitBuffer >>= (bitCount & 7);
+        bitCount -= (bitCount & 7);
+      }
+      
+      bool atEnd() const
+      {
+        return (pos >= len + 4) && (bitCount == 0);
+      }
+    };
+    
+    /////////////////////////////////////////////////////////
+    
+    struct DeflateHuffman
+    {
+      uint16_t count[16];       // number of codes of each length
+      uint16_t symbol[288];     // symbols ordered by code
+    };
+    
+    /////////////////////////////////////////////////////////
+    
+    // Code lengths and decoding tables of the block being inflated. Some 1.5 KB, too much for a small stack, and
+    // only one block is ever inflated at a time (the library is used from one task), so they live in static storage
+    struct DeflateInflateTables
+    {
+      uint8_t         lengths[320];     // literal / length codes then distance codes, as sent
+      DeflateHuffman  lengthCode;
+      DeflateHuffman  distanceCode;
+    };
+    
+    DeflateInflateTables& deflateInflateTables()
+    {
+      static DeflateInflateTables tables;
+      
+      return tables;
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    // Returns 0 for a complete code, > 0 if incomplete, < 0 if over-subscribed
+    int buildDeflateHuffman(DeflateHuffman& huffman, const uint8_t* lengths, const uint16_t n)
+    {
+      memset(huffman.count, 0, sizeof(huffman.count));
+      
+      for (uint16_t i = 0; i < n; i++) 
+        huffman.count[lengths[i]]++;
+        
+      if (huffman.count[0] == n) 
+        return 0;
+        
+      int left = 1;
+      
+      for (uint8_t len = 1; len < 16; len++) 
+      {
+        left <<= 1;
+        left -= huffman.count[len];
+        
+        if (left < 0) 
+          return left;
+      }
+      
+      uint16_t offsets[16];
+      offsets[1] = 0;
+      
+      for (uint8_t len = 1; len < 15; len++) 
+        offsets[len + 1] = offsets[len] + huffman.count[len];
+        
+      for (uint16_t i = 0; i < n; i++) 
+      {
+        if (lengths[i] != 0) 
+          huffman.symbol[offsets[lengths[i]]++] = i;
+      }
+      
+      return left;
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    int decodeDeflateSymbol(DeflateBitReader& reader, const DeflateHuffman& huffman)
+    {
+      int code = 0, first = 0, index = 0;
+      
+      for (uint8_t len = 1; len < 16; len++) 
+      {
+        code |= reader.bits(1);
+        
+        int count = huffman.count[len];
+        
+        if (code - count < first) 
+          return huffman.symbol[index + (code - first)];
+          
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+      }
+      
+      return -1;
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    InflateResult inflateDeflateCodes(DeflateBitReader& reader, WSString& out, const size_t limit,
+                                      const DeflateHuffman& lengthCode, const DeflateHuffman& distanceCode)
+    {
+      while (true) 
+      {
+        int symbol = decodeDeflateSymbol(reader, lengthCode);
+        
+        if (symbol < 0 || reader.overrun) 
+          return InflateResult_BadData;
+          
+        if (symbol < 256) 
+        {
+          out += static_cast<char>(symbol);
+        } 
+        else if (symbol == 256) 
+        {
+          return InflateResult_Ok;
+        } 
+        else 
+        {
+          symbol -= 257;
+          
+          if (symbol >= 29) 
+            return InflateResult_BadData;
+            
+          size_t length = DEFLATE_LENGTH_BASE[symbol] + reader.bits(DEFLATE_LENGTH_EXTRA[symbol]);
+          
+          symbol = decodeDeflateSymbol(reader, distanceCode);
+          
+          if (symbol < 0 || symbol >= 30) 
+            return InflateResult_BadData;
+            
+          size_t distance = DEFLATE_DIST_BASE[symbol] + reader.bits(DEFLATE_DIST_EXTRA[symbol]);
+          
+          if (distance > out.size()) 
+            return InflateResult_BadData;
+            
+          // Byte by byte, source and destination may overlap
+          size_t from = out.size() - distance;
+          
+          for (size_t i = 0; i < length; i++) 
+            out += out[from + i];
+        }
+        
+        if (out.size() > limit) 
+          return InflateResult_TooBig;
+      }
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    InflateResult inflateDynamicBlock(DeflateBitReader& reader, WSString& out, const size_t limit)
+    {
+      static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+      
+      DeflateInflateTables& tables  = deflateInflateTables();
+      uint8_t* lengths              = tables.lengths;
+      DeflateHuffman& lengthCode    = tables.lengthCode;
+      DeflateHuffman& distanceCode  = tables.distanceCode;
+      
+      uint16_t nlen  = reader.bits(5) + 257;
+      uint16_t ndist = reader.bits(5) + 1;
+      uint16_t ncode = reader.bits(4) + 4;
+      
+      if (nlen > 286 || ndist > 30) 
+        return InflateResult_BadData;
+        
+      memset(lengths, 0, sizeof(tables.lengths));
+      
+      for (uint16_t i = 0; i < ncode; i++) 
+        lengths[order[i]] = reader.bits(3);
+        
+      // Code lengths code, must be complete
+      if (buildDeflateHuffman(lengthCode, lengths, 19) != 0) 
+        return InflateResult_BadData;
+        
+      uint16_t index = 0;
+      
+      while (index < nlen + ndist) 
+      {
+        int symbol = decodeDeflateSymbol(reader, lengthCode);
+        
+        if (symbol < 0 || reader.overrun) 
+          return InflateResult_BadData;
+          
+        if (symbol < 16) 
+        {
+          lengths[index++] = symbol;
+          continue;
+        }
+        
+        uint8_t  value  = 0;
+        uint16_t repeat = 0;
+        
+        if (symbol == 16) 
+        {
+          if (index == 0) 
+            return InflateResult_BadData;
+            
+          value = lengths[index - 1];
+          repeat = 3 + reader.bits(2);
+        } 
+        else if (symbol == 17) 
+        {
+          repeat = 3 + reader.bits(3);
+        } 
+        else 
+        {
+          repeat = 11 + reader.bits(7);
+        }
+        
+        if (index + repeat > nlen + ndist) 
+          return InflateResult_BadData;
+          
+        while (repeat--) 
+          lengths[index++] = value;
+      }
+      
+      // Without an end-of-block code the block could never end
+      if (lengths[256] == 0) 
+        return InflateResult_BadData;
+        
+      int err = buildDeflateHuffman(lengthCode, lengths, nlen);
+      
+      if (err < 0 || (err > 0 && nlen - lengthCode.count[0] != 1)) 
+        return InflateResult_BadData;
+        
+      err = buildDeflateHuffman(distanceCode, lengths + nlen, ndist);
+      
+      if (err < 0 || (err > 0 && ndist - distanceCode.count[0] != 1)) 
+        return InflateResult_BadData;
+        
+      return inflateDeflateCodes(reader, out, limit, lengthCode, distanceCode);
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    InflateResult inflateFixedBlock(DeflateBitReader& reader, WSString& out, const size_t limit)
+    {
+      DeflateInflateTables& tables  = deflateInflateTables();
+      uint8_t* lengths              = tables.lengths;
+      DeflateHuffman& lengthCode    = tables.lengthCode;
+      DeflateHuffman& distanceCode  = tables.distanceCode;
+      
+      memset(lengths, 8, 144);
+      memset(lengths + 144, 9, 112);
+      memset(lengths + 256, 7, 24);
+      memset(lengths + 280, 8, 8);
+      buildDeflateHuffman(lengthCode, lengths, 288);
+      
+      memset(lengths, 5, 30);
+      buildDeflateHuffman(distanceCode, lengths, 30);
+      
+      return inflateDeflateCodes(reader, out, limit, lengthCode, distanceCode);
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    InflateResult inflateStoredBlock(DeflateBitReader& reader, WSString& out, const size_t limit)
+    {
+      reader.alignToByte();
+      
+      uint16_t length  = reader.bits(16);
+      uint16_t nlength = reader.bits(16);
+      
+      if (length != static_cast<uint16_t>(~nlength)) 
+        return InflateResult_BadData;
+        
+      if (out.size() + length > limit) 
+        return InflateResult_TooBig;
+        
+      for (uint16_t i = 0; i < length; i++) 
+        out += static_cast<char>(reader.bits(8));
+        
+      return reader.overrun ? InflateResult_BadData : InflateResult_Ok;
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    InflateResult PerMessageDeflate::decompress(const uint8_t* data, const size_t len, WSString& out)
+    {
+    #ifdef _WS_CONFIG_MAX_MESSAGE_SIZE
+      size_t limit = _WS_CONFIG_MAX_MESSAGE_SIZE;
+    #else
+      size_t limit = _WS_DEFLATE_MAX_MESSAGE_SIZE;
+    #endif
+    
+      // With context takeover, back references may reach into the previous messages
+      size_t historyLength = 0;
+      
+      if (this->_recvContextTakeover) 
+      {
+        out = std::move(this->_history);
+        historyLength = out.size();
+        this->_history = WSString();
+      }
+      else 
+      {
+        out.clear();
+      }
+      
+      if (limit < static_cast<size_t>(-1) - historyLength) 
+        limit += historyLength;
+      
+      out.reserve(historyLength + len * 2);
+      
+      DeflateBitReader reader(data, len);
+      InflateResult result = InflateResult_Ok;
+      bool last = false;
+      
+      while (result == InflateResult_Ok && !last && !reader.atEnd()) 
+      {
+        last = reader.bits(1);
+        
+        switch (reader.bits(2)) 
+        {
+          case 0:
+            result = inflateStoredBlock(reader, out, limit);
+            break;
+            
+          case 1:
+            result = inflateFixedBlock(reader, out, limit);
+            break;
+            
+          case 2:
+            result = inflateDynamicBlock(reader, out, limit);
+            break;
+            
+          default:
+            result = InflateResult_BadData;
+            break;
+        }
+        
+        if (reader.overrun) 
+          result = InflateResult_BadData;
+      }
+      
+      if (result != InflateResult_Ok) 
+      {
+        out.clear();
+        
+        return result;
+      }
+      
+      if (this->_recvContextTakeover) 
+      {
+        size_t window = static_cast<size_t>(1) << this->_recvWindowBits;
+        size_t keep = out.size() < window ? out.size() : window;
+        
+        this->_history.assign(out, out.size() - keep, keep);
+      }
+      
+      out.erase(0, historyLength);
+      
+      return InflateResult_Ok;
+    }
+  }   // namespace internals2_generic
+}     // namespace websockets2_generic
+
+#endif    // _WS_CONFIG_PERMESSAGE_DEFLATE
+
+#endif    // _WEBSOCKETS2_GENERIC_DEFLATE_H
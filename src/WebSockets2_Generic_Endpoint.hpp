@@ -113,8 +113,25 @@ namespace websockets2_generic
       _recvMode(other._recvMode),
       _streamBuilder(other._streamBuilder),
       _closeReason(other._closeReason),
-      _useMasking(other._useMasking)
+      _useMasking(other._useMasking),
+      _recvIntoStreamType(other._recvIntoStreamType),
+      _parser(other._parser),
+      _stats(other._stats),
+      _pingPending(other._pingPending),
+      _pingSentAt(other._pingSentAt),
+      _payloadSink(other._payloadSink),
+      _sinkType(other._sinkType),
+      _sinkOffset(other._sinkOffset)
     {
+      copyReceiveBuffer(other);
+      
+    #ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+      this->_deflate = other._deflate;
+      this->_deflateThreshold = other._deflateThreshold;
+      this->_inflateType = other._inflateType;
+      this->_inflateInput = other._inflateInput;
+    #endif
+      
       const_cast<WebsocketsEndpoint&>(other)._client = nullptr;
     }
     
@@ -124,8 +141,25 @@ namespace websockets2_generic
       _recvMode(other._recvMode),
       _streamBuilder(other._streamBuilder),
       _closeReason(other._closeReason),
-      _useMasking(other._useMasking)
+      _useMasking(other._useMasking),
+      _recvIntoStreamType(other._recvIntoStreamType),
+      _parser(other._parser),
+      _stats(other._stats),
+      _pingPending(other._pingPending),
+      _pingSentAt(other._pingSentAt),
+      _payloadSink(other._payloadSink),
+      _sinkType(other._sinkType),
+      _sinkOffset(other._sinkOffset)
     {
+      copyReceiveBuffer(other);
+      
+    #ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+      this->_deflate = other._deflate;
+      this->_deflateThreshold = other._deflateThreshold;
+      this->_inflateType = other._inflateType;
+      this->_inflateInput = other._inflateInput;
+    #endif
+      
       const_cast<WebsocketsEndpoint&>(other)._client = nullptr;
     }
     
@@ -136,6 +170,22 @@ namespace websockets2_generic
       this->_streamBuilder = other._streamBuilder;
       this->_closeReason = other._closeReason;
       this->_useMasking = other._useMasking;
+      this->_recvIntoStreamType = other._recvIntoStreamType;
+      this->_parser = other._parser;
+      this->_stats = other._stats;
+      this->_pingPending = other._pingPending;
+      this->_pingSentAt = other._pingSentAt;
+      this->_payloadSink = other._payloadSink;
+      this->_sinkType = other._sinkType;
+      this->_sinkOffset = other._sinkOffset;
+      copyReceiveBuffer(other);
+      
+    #ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+      this->_deflate = other._deflate;
+      this->_deflateThreshold = other._deflateThreshold;
+      this->_inflateType = other._inflateType;
+      this->_inflateInput = other._inflateInput;
+    #endif
     
       const_cast<WebsocketsEndpoint&>(other)._client = nullptr;
     
@@ -150,170 +200,682 @@ namespace websockets2_generic
       this->_streamBuilder = other._streamBuilder;
       this->_closeReason = other._closeReason;
       this->_useMasking = other._useMasking;
+      this->_recvIntoStreamType = other._recvIntoStreamType;
+      this->_parser = other._parser;
+      this->_stats = other._stats;
+      this->_pingPending = other._pingPending;
+      this->_pingSentAt = other._pingSentAt;
+      this->_payloadSink = other._payloadSink;
+      this->_sinkType = other._sinkType;
+      this->_sinkOffset = other._sinkOffset;
+      copyReceiveBuffer(other);
+      
+    #ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+      this->_deflate = other._deflate;
+      this->_deflateThreshold = other._deflateThreshold;
+      this->_inflateType = other._inflateType;
+      this->_inflateInput = other._inflateInput;
+    #endif
     
       const_cast<WebsocketsEndpoint&>(other)._client = nullptr;
     
       return *this;
     }
     
+    void WebsocketsEndpoint::copyReceiveBuffer(const WebsocketsEndpoint& other) 
+    {
+    #if (_WS_RX_BUFFER_SIZE > 0)
+      memmove(this->_rxBuffer, other._rxBuffer + other._rxStart, other._rxCount);
+      this->_rxStart = 0;
+      this->_rxCount = other._rxCount;
+    #else
+      (void) other;
+    #endif
+    }
+    
     void WebsocketsEndpoint::setInternalSocket(std::shared_ptr<network2_generic::TcpClient> socket) 
     {
       this->_client = socket;
+      
+      // Whatever was left of a frame belonged to the previous connection
+      resetParser();
+      this->_sinkType     = MessageType::Empty;
+      this->_pingPending  = false;
+      
+    #if (_WS_RX_BUFFER_SIZE > 0)
+      this->_rxStart = 0;
+      this->_rxCount = 0;
+    #endif
     }
     
-    bool WebsocketsEndpoint::poll() 
+    bool WebsocketsEndpoint::preloadReceived(const uint8_t* data, const size_t len) 
     {
-      return this->_client->poll();
+    #if (_WS_RX_BUFFER_SIZE > 0)
+      if (this->_rxCount + len > _WS_RX_BUFFER_SIZE)
+        return false;
+        
+      if (this->_rxCount > 0)
+      {
+        memmove(this->_rxBuffer, this->_rxBuffer + this->_rxStart, this->_rxCount);
+      }
+      
+      this->_rxStart = 0;
+      memcpy(this->_rxBuffer + this->_rxCount, data, len);
+      this->_rxCount += len;
+      this->_stats.bytesIn += len;
+      
+      return true;
+    #else
+      return len == 0;
+    #endif
     }
     
-    uint32_t readUntilSuccessfullOrError(network2_generic::TcpClient& socket, uint8_t* buffer, const uint32_t len) 
+#ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+    void WebsocketsEndpoint::setDeflate(const DeflateParams& params, const bool isServer) 
     {
-      auto numRead = socket.read(buffer, len);
-      
-      while (numRead == static_cast<uint32_t>(-1) && socket.available()) 
+      if (params.enabled) 
       {
-        numRead = socket.read(buffer, len);
+        this->_deflate = std::make_shared<PerMessageDeflate>(params, isServer);
+        this->_deflate->setThreshold(this->_deflateThreshold);
       }
-      
-      return numRead;
+      else 
+      {
+        this->_deflate = nullptr;
+      }
+        
+      this->_inflateType = MessageType::Empty;
+      this->_inflateInput = WSString();
     }
     
-    Header readHeaderFromSocket(network2_generic::TcpClient& socket) 
+    bool WebsocketsEndpoint::isDeflateEnabled() const 
     {
-      Header header;
-      header.payload = 0;
-      
-      readUntilSuccessfullOrError(socket, reinterpret_cast<uint8_t*>(&header), 2);
+      return this->_deflate != nullptr;
+    }
+    
+    void WebsocketsEndpoint::setDeflateThreshold(const size_t threshold) 
+    {
+      this->_deflateThreshold = threshold;
       
-      return header;
+      if (this->_deflate)
+        this->_deflate->setThreshold(threshold);
     }
     
-    uint64_t readExtendedPayloadLength(network2_generic::TcpClient& socket, const Header& header) 
+    // Collects the frames of a compressed message. Returns true once it is complete, `frame` then
+    // holds the whole message, inflated, as a single unfragmented frame
+    bool WebsocketsEndpoint::receiveCompressed(WebsocketsFrame& frame) 
     {
-      uint64_t extendedPayload = header.payload;
+      if (frame.opcode != ContentType::Continuation) 
+      {
+        this->_inflateType = messageTypeFromOpcode(frame.opcode);
+        this->_inflateInput = std::move(frame.payload);
+      } 
+      else 
+      {
+        this->_inflateInput += frame.payload;
+      }
       
-      // in case of extended payload length
-      if (header.payload == 126) 
+    #ifdef _WS_CONFIG_MAX_MESSAGE_SIZE
+      if (this->_inflateInput.size() > _WS_CONFIG_MAX_MESSAGE_SIZE) 
       {
-        // read next 16 bits as payload length
-        uint16_t tmp = 0;
-        readUntilSuccessfullOrError(socket, reinterpret_cast<uint8_t*>(&tmp), 2);
-        tmp = (tmp << 8) | (tmp >> 8);
-        extendedPayload = tmp;
+        this->_inflateType = MessageType::Empty;
+        this->_inflateInput = WSString();
+        close(CloseReason_MessageTooBig);
+        
+        return false;
       }
-      else if (header.payload == 127) 
+    #endif
+      
+      if (!frame.fin) 
+        return false;
+        
+      WSString message;
+      auto result = this->_deflate->decompress(reinterpret_cast<const uint8_t*>(this->_inflateInput.data()), 
+                                               this->_inflateInput.size(), message);
+      
+      MessageType type = this->_inflateType;
+      
+      this->_inflateType = MessageType::Empty;
+      this->_inflateInput = WSString();
+      
+      if (result != InflateResult_Ok) 
       {
-        uint64_t tmp = 0;
-        readUntilSuccessfullOrError(socket, reinterpret_cast<uint8_t*>(&tmp), 8);
-        extendedPayload = swapEndianess(tmp);
+        close(result == InflateResult_TooBig ? CloseReason_MessageTooBig : CloseReason_InvalidPayloadData);
+        
+        return false;
       }
+      
+      frame.fin             = 1;
+      frame.opcode          = (type == MessageType::Text) ? ContentType::Text : ContentType::Binary;
+      frame.mask            = 0;
+      frame.payload_length  = message.size();
+      frame.payload         = std::move(message);
+      
+      return true;
+    }
+#endif
+
+    void WebsocketsEndpoint::setPayloadSink(const std::function<void(const WebsocketsPayloadChunk&)> sink) 
+    {
+      this->_payloadSink = sink;
+    }
+    
+    bool WebsocketsEndpoint::poll() 
+    {
+    #if (_WS_RX_BUFFER_SIZE > 0)
+      // The parser drains the buffer before waiting on the socket, so buffered bytes are always parseable
+      if (this->_rxCount > 0)
+        return true;
+    #endif
     
-      return extendedPayload;
+      return this->_client->poll();
     }
     
-    void readMaskingKey(network2_generic::TcpClient& socket, uint8_t* outputBuffer) 
+    void remaskData(WSString& data, const uint8_t* const maskingKey, uint64_t payloadLength) 
     {
-      readUntilSuccessfullOrError(socket, reinterpret_cast<uint8_t*>(outputBuffer), 4);
+      if (payloadLength > 0)
+      {
+        maskPayload(reinterpret_cast<uint8_t*>(&data[0]), payloadLength, maskingKey);
+      }
     }
     
-    WSString readData(network2_generic::TcpClient& socket, uint64_t extendedPayload) 
+    void remaskData(uint8_t* data, const uint8_t* const maskingKey, uint64_t payloadLength) 
     {
-      const uint64_t BUFFER_SIZE = _WS_BUFFER_SIZE;
+      maskPayload(data, payloadLength, maskingKey);
+    }
     
-      WSString data(extendedPayload, '\0');
-      uint8_t buffer[BUFFER_SIZE];
-      uint64_t done_reading = 0;
+#if (_WS_RX_BUFFER_SIZE > 0)
+    uint32_t WebsocketsEndpoint::takeBuffered(uint8_t* buffer, const uint32_t len) 
+    {
+      uint32_t toCopy = len < this->_rxCount ? len : this->_rxCount;
       
-      while (done_reading < extendedPayload && socket.available()) 
+      memcpy(buffer, this->_rxBuffer + this->_rxStart, toCopy);
+      
+      this->_rxStart += toCopy;
+      this->_rxCount -= toCopy;
+      
+      return toCopy;
+    }
+#endif
+
+    // Reads up to `len` bytes, returns 0 if nothing is available right now
+    uint32_t WebsocketsEndpoint::readSome(uint8_t* buffer, const uint32_t len) 
+    {
+    #if (_WS_RX_BUFFER_SIZE > 0)
+      uint32_t done = takeBuffered(buffer, len);
+      
+      if (done == len)
+        return done;
+      
+      if (len - done >= _WS_RX_BUFFER_SIZE) 
       {
-        uint64_t to_read = extendedPayload - done_reading >= BUFFER_SIZE ? BUFFER_SIZE : extendedPayload - done_reading;
-        uint32_t numReceived = readUntilSuccessfullOrError(socket, buffer, to_read);
-    
-        // On failed reads, skip
-        if (!socket.available()) 
-          break;
+        // Big payload reads don't gain anything from the buffer, read them in place
+        auto numRead = this->_client->read(buffer + done, len - done);
+        
+        if (numRead == static_cast<uint32_t>(-1))
+          return done;
+        
+        this->_stats.bytesIn += numRead;
+        
+        return done + numRead;
+      }
+      
+      // One batched read, whatever is left over serves the next fields / frames
+      auto numRead = this->_client->read(this->_rxBuffer, _WS_RX_BUFFER_SIZE);
+      
+      if (numRead == static_cast<uint32_t>(-1) || numRead == 0)
+        return done;
+        
+      this->_stats.bytesIn += numRead;
+      this->_rxStart = 0;
+      this->_rxCount = numRead;
+      
+      return done + takeBuffered(buffer + done, len - done);
+    #else
+      auto numRead = this->_client->read(buffer, len);
+      
+      // -1 means nothing is available right now
+      if (numRead == static_cast<uint32_t>(-1))
+        return 0;
+      
+      this->_stats.bytesIn += numRead;
+      
+      return numRead;
+    #endif
+    }
     
-        for (uint64_t i = 0; i < numReceived; i++) 
-        {
-          data[done_reading + i] = static_cast<char>(buffer[i]);
-        }
+    void WebsocketsEndpoint::resetParser() 
+    {
+      this->_parser.stage       = RecvStage_Header;
+      this->_parser.fieldLength = 2;
+      this->_parser.fieldRead   = 0;
+      this->_parser.payloadRead = 0;
+      this->_parser.frame       = WebsocketsFrame();
+      this->_parser.sink        = false;
+      this->_parser.compressed  = false;
+    }
     
-        done_reading += numReceived;
+    // Collects the current header field (2 bytes header, 2/8 bytes length or 4 bytes masking key),
+    // keeping what was already read if the socket runs dry
+    bool WebsocketsEndpoint::readField() 
+    {
+      while (this->_parser.fieldRead < this->_parser.fieldLength) 
+      {
+        uint32_t numRead = readSome(this->_parser.field + this->_parser.fieldRead, this->_parser.fieldLength - this->_parser.fieldRead);
+        
+        if (numRead == 0) 
+          return false;
+          
+        this->_parser.fieldRead += numRead;
       }
       
-      // KH, Don't need return std::move(data);
-      return data;
+      this->_parser.fieldRead = 0;
+      
+      return true;
     }
     
-    void remaskData(WSString& data, const uint8_t* const maskingKey, uint64_t payloadLength) 
+    // Called once the payload length is known
+    bool WebsocketsEndpoint::beginPayload(uint8_t* external, const size_t capacity) 
     {
-      for (uint64_t i = 0; i < payloadLength; i++) 
+      WebsocketsFrame& frame = this->_parser.frame;
+      
+      // Compressed messages have to be inflated as a whole, they always go through frame.payload
+      if (this->_parser.compressed) 
+        external = nullptr;
+        
+      // Data frames bypass the size limits when streamed, nothing is buffered for them
+      this->_parser.sink = this->_payloadSink && (external == nullptr) && (frame.opcode < 0x8) && !this->_parser.compressed;
+      
+      if (this->_parser.sink) 
       {
-        data[i] = data[i] ^ maskingKey[i % 4];
+        if (!beginSinkFrame()) 
+          return false;
       }
+      
+      bool tooBig = !this->_parser.sink && (external != nullptr) && (frame.payload_length > capacity);
+      
+    #ifdef _WS_CONFIG_MAX_MESSAGE_SIZE
+      tooBig = tooBig || (!this->_parser.sink && (frame.payload_length > _WS_CONFIG_MAX_MESSAGE_SIZE));
+    #endif
+    
+      if (tooBig) 
+      {
+        resetParser();
+        close(CloseReason_MessageTooBig);
+        
+        return false;
+      }
+      
+      if (!this->_parser.sink && (external == nullptr)) 
+      {
+        // The only allocation for this frame, the payload is read straight into it
+        frame.payload.resize(frame.payload_length);
+      }
+      
+      if (frame.mask) 
+      {
+        this->_parser.stage       = RecvStage_MaskingKey;
+        this->_parser.fieldLength = 4;
+      } 
+      else 
+      {
+        this->_parser.stage = RecvStage_Payload;
+      }
+      
+      return true;
     }
     
-    WebsocketsFrame WebsocketsEndpoint::_recv() 
+    // RSV1 marks the first frame of a compressed message (permessage-deflate), RSV2 and RSV3 are never used
+    bool WebsocketsEndpoint::checkReservedBits(const uint8_t rsv) 
     {
-      auto header = readHeaderFromSocket(*this->_client);
+      bool valid = (rsv == 0);
       
-      if (!_client->available()) 
-        return WebsocketsFrame(); // In case of faliure
-    
-      uint64_t payloadLength = readExtendedPayloadLength(*this->_client, header);
+    #ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+      WebsocketsFrame& frame = this->_parser.frame;
+      
+      bool isData = (frame.opcode < 0x8);
+      bool isFirst = isData && (frame.opcode != ContentType::Continuation);
+      
+      if (rsv == 0x04) 
+        valid = this->_deflate && isFirst;
       
-      if (!_client->available()) 
-        return WebsocketsFrame(); // In case of faliure
+      // A new message can't start in the middle of a compressed one
+      if (isFirst && this->_inflateType != MessageType::Empty) 
+        valid = false;
+        
+      this->_parser.compressed = (rsv == 0x04) || (isData && !isFirst && this->_inflateType != MessageType::Empty);
+    #endif
     
-    #ifdef _WS_CONFIG_MAX_MESSAGE_SIZE
-      if (payloadLength > _WS_CONFIG_MAX_MESSAGE_SIZE) 
+      if (!valid) 
       {
-        return WebsocketsFrame();
+        resetParser();
+        close(CloseReason_ProtocolError);
       }
-    #endif
+      
+      return valid;
+    }
     
-      uint8_t maskingKey[4];
+    // Checks the fragment sequence of a frame about to be streamed to the payload sink
+    bool WebsocketsEndpoint::beginSinkFrame() 
+    {
+      WebsocketsFrame& frame = this->_parser.frame;
       
-      // if masking is set
-      if (header.mask) 
+      if (frame.opcode == ContentType::Continuation) 
       {
-        readMaskingKey(*this->_client, maskingKey);
+        if (this->_sinkType != MessageType::Empty) 
+          return true;
+      }
+      else if (this->_sinkType == MessageType::Empty) 
+      {
+        this->_sinkType   = messageTypeFromOpcode(frame.opcode);
+        this->_sinkOffset = 0;
         
-        if (!_client->available()) 
-          return WebsocketsFrame(); // In case of faliure
+        if (this->_sinkType != MessageType::Empty) 
+          return true;
       }
-    
-      WebsocketsFrame frame;
-      // read the message's payload (data) according to the read length
-      frame.payload = readData(*this->_client, payloadLength);
       
-      if (!_client->available()) 
-        return WebsocketsFrame(); // In case of faliure
+      // This is an error. a bad combination of opcodes and fin flag arrived.
+      resetParser();
+      this->_sinkType = MessageType::Empty;
+      close(CloseReason_ProtocolError);
+      
+      return false;
+    }
     
-      // if masking is set un-mask the message
-      if (header.mask) 
+    // Passes the payload to the sink in pieces, as it is read from the socket.
+    // Returns true once the whole frame went through
+    bool WebsocketsEndpoint::readIntoSink() 
+    {
+      WebsocketsFrame& frame = this->_parser.frame;
+      uint8_t chunk[_WS_BUFFER_SIZE];
+      
+      WebsocketsPayloadChunk info;
+      info.type = this->_sinkType;
+      
+      do 
+      {
+        uint64_t remaining  = frame.payload_length - this->_parser.payloadRead;
+        uint32_t toRead     = remaining > sizeof(chunk) ? sizeof(chunk) : static_cast<uint32_t>(remaining);
+        uint32_t numRead    = 0;
+        
+        if (toRead > 0) 
+        {
+          numRead = readSome(chunk, toRead);
+          
+          if (numRead == 0) 
+            return false;
+          
+          if (frame.mask) 
+          {
+            // The key phase depends on where this piece sits inside the frame
+            maskPayload(chunk, numRead, frame.mask_buf, this->_parser.payloadRead);
+          }
+        }
+        
+        this->_parser.payloadRead += numRead;
+        
+        info.offset = this->_sinkOffset;
+        info.data   = reinterpret_cast<const char*>(chunk);
+        info.length = numRead;
+        info.final  = frame.fin && (this->_parser.payloadRead == frame.payload_length);
+        
+        this->_sinkOffset += numRead;
+        
+        // Empty pieces are only worth reporting when they end the message
+        if (numRead > 0 || info.final) 
+        {
+          this->_payloadSink(info);
+        }
+      } while (this->_parser.payloadRead < frame.payload_length);
+      
+      if (frame.fin) 
       {
-        remaskData(frame.payload, maskingKey, payloadLength);
+        this->_sinkType = MessageType::Empty;
       }
+      
+      return true;
+    }
     
-      // Construct frame from data and header that was read
-      frame.fin = header.fin;
-      frame.mask = header.mask;
-    
-      frame.mask_buf[0] = maskingKey[0];
-      frame.mask_buf[1] = maskingKey[1];
-      frame.mask_buf[2] = maskingKey[2];
-      frame.mask_buf[3] = maskingKey[3];
+    // Advances the frame parser with whatever the socket has available. Returns true once a
+    // complete (and unmasked) frame is in _parser.frame, false if more bytes are needed or
+    // the frame was consumed by the payload sink
+    bool WebsocketsEndpoint::parseFrame(uint8_t* external, const size_t capacity) 
+    {
+      WebsocketsFrame& frame = this->_parser.frame;
+      
+      while (true) 
+      {
+        switch (this->_parser.stage) 
+        {
+          case RecvStage_Header:
+          
+            if (!readField()) 
+              return false;
+              
+            frame.fin             = this->_parser.field[0] >> 7;
+            frame.opcode          = this->_parser.field[0] & 0x0F;
+            frame.mask            = this->_parser.field[1] >> 7;
+            frame.payload_length  = this->_parser.field[1] & 0x7F;
+            
+            if (!checkReservedBits((this->_parser.field[0] >> 4) & 0x07)) 
+              return false;
+            
+            this->_stats.addFrame(true, frame.opcode, frame.fin);
+            
+            if (frame.payload_length == 126 || frame.payload_length == 127) 
+            {
+              // 16 or 64 bits extended payload length follows
+              this->_parser.stage       = RecvStage_ExtendedLength;
+              this->_parser.fieldLength = (frame.payload_length == 126) ? 2 : 8;
+            } 
+            else if (!beginPayload(external, capacity)) 
+            {
+              return false;
+            }
+            
+            break;
+            
+          case RecvStage_ExtendedLength:
+          
+            if (!readField()) 
+              return false;
+            
+            // Network byte order
+            frame.payload_length = 0;
+            
+            for (uint8_t i = 0; i < this->_parser.fieldLength; i++) 
+            {
+              frame.payload_length = (frame.payload_length << 8) | this->_parser.field[i];
+            }
+            
+            if (!beginPayload(external, capacity)) 
+              return false;
+            
+            break;
+            
+          case RecvStage_MaskingKey:
+          
+            if (!readField()) 
+              return false;
+            
+            memcpy(frame.mask_buf, this->_parser.field, 4);
+            this->_parser.stage = RecvStage_Payload;
+            
+            break;
+            
+          case RecvStage_Payload:
+          {
+            if (this->_parser.sink) 
+            {
+              if (readIntoSink()) 
+              {
+                resetParser();
+              }
+              
+              return false;
+            }
+            
+            uint8_t* payload = (external != nullptr && !this->_parser.compressed) ? external : reinterpret_cast<uint8_t*>(&frame.payload[0]);
+            
+            while (this->_parser.payloadRead < frame.payload_length) 
+            {
+              uint64_t remaining = frame.payload_length - this->_parser.payloadRead;
+              uint32_t toRead = remaining > 0x7FFFFFFF ? 0x7FFFFFFF : static_cast<uint32_t>(remaining);
+              uint32_t numRead = readSome(payload + this->_parser.payloadRead, toRead);
+              
+              if (numRead == 0) 
+                return false;
+              
+              this->_parser.payloadRead += numRead;
+            }
+            
+            // if masking is set un-mask the message
+            if (frame.mask) 
+            {
+              remaskData(payload, frame.mask_buf, frame.payload_length);
+            }
+            
+            return true;
+          }
+        }
+      }
+    }
     
-      frame.opcode = header.opcode;
-      frame.payload_length = payloadLength;
+    WebsocketsFrame WebsocketsEndpoint::_recv() 
+    {
+      // Partial frames stay in the parser until the rest arrives
+      if (!parseFrame(nullptr, 0))
+        return WebsocketsFrame();
+        
+      WebsocketsFrame frame = std::move(this->_parser.frame);
+      bool compressed = this->_parser.compressed;
+      
+      resetParser();
+      
+    #ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+      if (compressed) 
+      {
+        if (!receiveCompressed(frame))
+          return WebsocketsFrame();
+          
+        if (this->_payloadSink) 
+        {
+          // Can't be streamed, the sink gets the inflated message in one piece
+          WebsocketsPayloadChunk chunk;
+          
+          chunk.type    = messageTypeFromOpcode(frame.opcode);
+          chunk.data    = frame.payload.data();
+          chunk.length  = frame.payload.size();
+          chunk.final   = true;
+          
+          this->_payloadSink(chunk);
+          
+          return WebsocketsFrame();
+        }
+      }
+    #else
+      (void) compressed;
+    #endif
     
       // KH, Don't need return std::move(frame);
       return frame;
     }
     
+    WebsocketsPayloadInfo WebsocketsEndpoint::recvInto(char* buffer, const size_t capacity) 
+    {
+      if (!parseFrame(reinterpret_cast<uint8_t*>(buffer), capacity))
+        return {};
+        
+      WebsocketsFrame frame = std::move(this->_parser.frame);
+      bool compressed = this->_parser.compressed;
+      
+      resetParser();
+      
+      if (frame.isEmpty())
+        return {};
+      
+      WebsocketsPayloadInfo info;
+      info.length = frame.payload_length;
+      
+    #ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+      if (compressed) 
+      {
+        // Compressed messages are only returned once complete and inflated
+        if (!receiveCompressed(frame))
+          return {};
+          
+        if (frame.payload_length > capacity) 
+        {
+          close(CloseReason_MessageTooBig);
+          
+          return {};
+        }
+        
+        memcpy(buffer, frame.payload.data(), frame.payload_length);
+        
+        info.type   = messageTypeFromOpcode(frame.opcode);
+        info.length = frame.payload_length;
+        
+        return info;
+      }
+    #else
+      (void) compressed;
+    #endif
+      
+      if (frame.isControlFrame()) 
+      {
+        info.type = messageTypeFromOpcode(frame.opcode);
+        handleControlInternally(info.type, buffer, info.length);
+        
+        return info;
+      }
+      else if (frame.isNormalUnfragmentedMessage() && this->_recvIntoStreamType == MessageType::Empty) 
+      {
+        info.type = messageTypeFromOpcode(frame.opcode);
+        info.role = MessageRole::Complete;
+      }
+      else if (frame.isBeginningOfFragmentsStream() && this->_recvIntoStreamType == MessageType::Empty) 
+      {
+        info.type = messageTypeFromOpcode(frame.opcode);
+        info.role = MessageRole::First;
+        this->_recvIntoStreamType = info.type;
+      }
+      else if (frame.isContinuesFragment() && this->_recvIntoStreamType != MessageType::Empty) 
+      {
+        info.type = this->_recvIntoStreamType;
+        info.role = MessageRole::Continuation;
+      }
+      else if (frame.isEndOfFragmentsStream() && this->_recvIntoStreamType != MessageType::Empty) 
+      {
+        info.type = this->_recvIntoStreamType;
+        info.role = MessageRole::Last;
+        this->_recvIntoStreamType = MessageType::Empty;
+      }
+      
+      if (info.type == MessageType::Empty) 
+      {
+        // This is an error. a bad combination of opcodes and fin flag arrived.
+        close(CloseReason_ProtocolError);
+        
+        return {};
+      }
+      
+      return info;
+    }
+    
     WebsocketsMessage WebsocketsEndpoint::handleFrameInStreamingMode(WebsocketsFrame& frame) 
     {
+    #ifdef _WS_CONFIG_MAX_MESSAGE_SIZE
+      // Each frame was checked on its own, an aggregated message must fit as a whole too
+      if ( (frame.isContinuesFragment() || frame.isEndOfFragmentsStream()) && (this->_fragmentsPolicy == FragmentsPolicy_Aggregate) && 
+           (this->_streamBuilder.size() + frame.payload.size() > _WS_CONFIG_MAX_MESSAGE_SIZE) ) 
+      {
+        this->_recvMode       = RecvMode_Normal;
+        this->_streamBuilder  = WebsocketsMessage::StreamBuilder(false);
+        close(CloseReason_MessageTooBig);
+        
+        return {};
+      }
+    #endif
       
       if (frame.isControlFrame()) 
       {
@@ -330,6 +892,8 @@ namespace websockets2_generic
     
         if (this->_streamBuilder.isEmpty()) 
         {
+          // Notified fragments go to the user, the builder must not take their payload
+          this->_streamBuilder = WebsocketsMessage::StreamBuilder(this->_fragmentsPolicy == FragmentsPolicy_Notify);
           this->_streamBuilder.first(frame);
           
           // if policy is set to notify, return the frame to the user
@@ -433,17 +997,34 @@ namespace websockets2_generic
     
     void WebsocketsEndpoint::handleMessageInternally(WebsocketsMessage& msg) 
     {
-      if (msg.isPing()) 
+      handleControlInternally(msg.type(), msg.c_str(), msg.rawData().size());
+    }
+    
+    void WebsocketsEndpoint::handleControlInternally(const MessageType type, const char* data, const size_t len) 
+    {
+      if (type == MessageType::Pong) 
+      {
+        // Unsolicited pongs (RFC 6455, 5.5.3) don't measure anything
+        if (this->_pingPending) 
+        {
+          this->_pingPending = false;
+          this->_stats.addRtt(micros() - this->_pingSentAt);
+        }
+      }
+      else if (type == MessageType::Ping) 
       {
-        pong(internals2_generic::fromInterfaceString(msg.data()));
+        // Pong data must be shorter than 125 bytes
+        if (len <= 125)
+        {
+          send(data, len, ContentType::Pong, true, this->_useMasking);
+        }
       } 
-      else if (msg.isClose()) 
+      else if (type == MessageType::Close) 
       {
         // is there a reason field
-        if (internals2_generic::fromInterfaceString(msg.data()).size() >= 2) 
+        if (len >= 2) 
         {
-          uint16_t reason = *(reinterpret_cast<const uint16_t*>(msg.data().c_str()));
-          reason = reason >> 8 | reason << 8;
+          uint16_t reason = (static_cast<uint8_t>(data[0]) << 8) | static_cast<uint8_t>(data[1]);
           this->_closeReason = GetCloseReason(reason);
         } 
         else 
@@ -470,40 +1051,32 @@ namespace websockets2_generic
       return send(data.c_str(), data.size(), opcode, fin, mask, maskingKey);
     }
     
-    std::string WebsocketsEndpoint::getHeader(uint64_t len, uint8_t opcode, bool fin, bool mask) 
+    // Writes the frame header (2 bytes, plus 2 or 8 bytes of extended payload length) into `buffer`,
+    // which must hold at least 10 bytes. Returns the number of bytes written
+    size_t WebsocketsEndpoint::writeHeader(uint8_t* buffer, uint64_t len, uint8_t opcode, bool fin, bool mask, bool compressed) 
     {
-      std::string header_data;
-    
+      // RSV1 flags a permessage-deflate compressed message
+      buffer[0] = (fin ? 0x80 : 0x00) | (compressed ? 0x40 : 0x00) | (opcode & 0x0F);
+      buffer[1] = mask ? 0x80 : 0x00;
+      
       if (len < 126) 
       {
-        auto header = MakeHeader<Header>(len, opcode, fin, mask);
-        header_data = std::string(reinterpret_cast<char*>(&header), 2 + 0);
-      } 
-      else if (len < 65536) 
-      {
-        auto header = MakeHeader<HeaderWithExtended16>(len, opcode, fin, mask);
-        header.extendedPayload = (len << 8) | (len >> 8);
-        header_data = std::string(reinterpret_cast<char*>(&header), 2 + 2);
+        buffer[1] |= len;
+        
+        return 2;
       } 
-      else 
+      
+      // Extended payload length, in network byte order
+      uint8_t extendedBytes = (len < 65536) ? 2 : 8;
+      
+      buffer[1] |= (len < 65536) ? 126 : 127;
+      
+      for (uint8_t i = 0; i < extendedBytes; i++) 
       {
-        auto header = MakeHeader<HeaderWithExtended64>(len, opcode, fin, mask);
-        // header.extendedPayload = swapEndianess(len);
-        header.extendedPayload = swapEndianess(len);
-    
-        header_data = std::string(reinterpret_cast<char*>(&header), 2);
-        header_data += std::string(reinterpret_cast<char*>(&header.extendedPayload), 8);
+        buffer[1 + extendedBytes - i] = static_cast<uint8_t>(len >> (8 * i));
       }
     
-      return header_data;
-    }
-    
-    void remaskData(WSString& data, const char* const maskingKey, size_t first, size_t len) 
-    {
-      for (size_t i = first; i < first + len; i++) 
-      {
-        data[i] = data[i] ^ maskingKey[i % 4];
-      }
+      return 2 + extendedBytes;
     }
     
     bool WebsocketsEndpoint::send(const char* data, const size_t len, const uint8_t opcode, const bool fin, const bool mask, const char* maskingKey) 
@@ -512,28 +1085,110 @@ namespace websockets2_generic
     #ifdef _WS_CONFIG_MAX_MESSAGE_SIZE
       if (len > _WS_CONFIG_MAX_MESSAGE_SIZE) 
       {
+        this->_stats.failedSends++;
         return false;
       }
     #endif
-      // send the header
-      std::string message_data = getHeader(len, opcode, fin, mask);
     
-      if (mask) 
+    #ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+      // Only whole messages get compressed, fragments sent with stream() / end() go out as they are
+      if (this->_deflate && fin && (opcode == ContentType::Text || opcode == ContentType::Binary)) 
       {
-        message_data += std::string(maskingKey, 4);
+        WSString compressed;
+        
+        if (this->_deflate->compress(reinterpret_cast<const uint8_t*>(data), len, compressed)) 
+          return sendFrame(compressed.data(), compressed.size(), opcode, fin, mask, maskingKey, true);
       }
+    #endif
     
-      size_t data_start = message_data.size();
-      message_data += std::string(data, len);
+      return sendFrame(data, len, opcode, fin, mask, maskingKey, false);
+    }
     
-      if (mask && memcmp(maskingKey, __TINY_WS_INTERNAL_DEFAULT_MASK, 4) != 0) 
+    bool WebsocketsEndpoint::sendFrame(const char* data, const size_t len, const uint8_t opcode, const bool fin, const bool mask, const char* maskingKey, const bool compressed) 
+    {
+      if (!this->_client->available()) 
+        return sendFailed();
+      
+      // The header is built on the stack, the payload is never copied as a whole. At most 2 bytes, 8 of
+      // extended length and the masking key
+      uint8_t header[14];
+      size_t headerSize = writeHeader(header, len, opcode, fin, mask, compressed);
+    
+      if (mask) 
       {
-        remaskData(message_data, maskingKey, data_start, len);
+        memcpy(header + headerSize, maskingKey, 4);
+        headerSize += 4;
       }
+      
+      const uint8_t* payload = reinterpret_cast<const uint8_t*>(data);
+      
+      if (!mask || memcmp(maskingKey, __TINY_WS_INTERNAL_DEFAULT_MASK, 4) == 0) 
+      {
+        // Nothing to transform, the payload goes out from the caller's memory
+        network2_generic::TcpSegment segments[2] = 
+        {
+          { header, static_cast<uint32_t>(headerSize) },
+          { payload, static_cast<uint32_t>(len) }
+        };
+        
+        if (!this->_client->sendSegments(segments, len > 0 ? 2 : 1))
+          return sendFailed();
+          
+        return frameSent(headerSize + len, opcode, fin);
+      }
+      
+      if (!sendMasked(header, headerSize, payload, len, reinterpret_cast<const uint8_t*>(maskingKey)))
+        return sendFailed();
+      
+      return frameSent(headerSize + len, opcode, fin);
+    }
     
-      this->_client->send(reinterpret_cast<const uint8_t*>(message_data.c_str()), message_data.size());
+    // Masks the payload chunk by chunk into a _WS_BUFFER_SIZE stack buffer, behind the header for the first one.
+    // Kept apart from sendFrame() so unmasked frames don't reserve it on top of the one in sendSegments()
+    bool WebsocketsEndpoint::sendMasked(const uint8_t* header, const size_t headerSize, const uint8_t* payload, 
+                                        const size_t len, const uint8_t* maskingKey) 
+    {
+      uint8_t buffer[_WS_BUFFER_SIZE];
+      
+      memcpy(buffer, header, headerSize);
       
-      return true; // TODO dont assume success
+      size_t used = headerSize;
+      size_t done = 0;
+      
+      do 
+      {
+        size_t chunk = len - done;
+        
+        if (chunk > sizeof(buffer) - used)
+          chunk = sizeof(buffer) - used;
+          
+        // The key index is relative to the payload start
+        maskPayload(buffer + used, payload + done, chunk, maskingKey, done);
+        
+        if (!this->_client->send(buffer, used + chunk))
+          return false;
+        
+        done += chunk;
+        used  = 0;
+      } while (done < len);
+      
+      return true;
+    }
+    
+    // Frames only count once the transport took all of them
+    bool WebsocketsEndpoint::frameSent(const size_t bytes, const uint8_t opcode, const bool fin) 
+    {
+      this->_stats.bytesOut += bytes;
+      this->_stats.addFrame(false, opcode, fin);
+      
+      return true;
+    }
+    
+    bool WebsocketsEndpoint::sendFailed() 
+    {
+      this->_stats.failedSends++;
+      
+      return false;
     }
     
     void WebsocketsEndpoint::close(CloseReason reason) 
@@ -564,51 +1219,57 @@ namespace websockets2_generic
     
     bool WebsocketsEndpoint::ping(const WSString& msg) 
     {
-      // Ping data must be shorter than 125 bytes
-      if (msg.size() > 125) 
-      {
-        return false;
-      }
-      else 
-      {
-        return send(msg, ContentType::Ping, true, this->_useMasking);
-      }
+      return ping(msg.c_str(), msg.size());
     }
+    
     bool WebsocketsEndpoint::ping(const WSString&& msg) 
+    {
+      return ping(msg.c_str(), msg.size());
+    }
+    
+    bool WebsocketsEndpoint::ping(const char* data, const size_t len) 
     {
       // Ping data must be shorter than 125 bytes
-      if (msg.size() > 125) 
+      if (len > 125) 
       {
+        this->_stats.failedSends++;
         return false;
       }
-      else 
+      
+      if (!send(data, len, ContentType::Ping, true, this->_useMasking))
+        return false;
+      
+      // Only the first of several pings in flight is timed, a pong can't be matched to a ping otherwise
+      if (!this->_pingPending) 
       {
-        return send(msg, ContentType::Ping, true, this->_useMasking);
+        this->_pingPending  = true;
+        this->_pingSentAt   = micros();
       }
+      
+      return true;
     }
     
     bool WebsocketsEndpoint::pong(const WSString& msg) 
     {
-      // Pong data must be shorter than 125 bytes
-      if (msg.size() > 125)  
-      {
-        return false;
-      }
-      else 
-      {
-        return this->send(msg, ContentType::Pong, true, this->_useMasking);
-      }
+      return pong(msg.c_str(), msg.size());
     }
+    
     bool WebsocketsEndpoint::pong(const WSString&& msg) 
+    {
+      return pong(msg.c_str(), msg.size());
+    }
+    
+    bool WebsocketsEndpoint::pong(const char* data, const size_t len) 
     {
       // Pong data must be shorter than 125 bytes
-      if (msg.size() > 125)  
+      if (len > 125)  
       {
+        this->_stats.failedSends++;
         return false;
       }
       else 
       {
-        return this->send(msg, ContentType::Pong, true, this->_useMasking);
+        return this->send(data, len, ContentType::Pong, true, this->_useMasking);
       }
     }
     
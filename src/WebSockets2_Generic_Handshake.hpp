@@ -0,0 +1,348 @@
+/****************************************************************************************************************************
+  WebSockets2_Generic_Handshake.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+
+#ifndef _WEBSOCKETS2_GENERIC_HANDSHAKE_H
+#define _WEBSOCKETS2_GENERIC_HANDSHAKE_H
+
+#pragma once
+
+// KH
+#include <WebSockets2_Generic.h>
+
+#include <Tiny_Websockets_Generic/internals/ws_handshake.hpp>
+
+namespace websockets2_generic
+{
+  namespace internals2_generic
+  {
+    inline char handshakeLower(const char c) 
+    {
+      return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+    }
+    
+    // `text` is already lowercase
+    inline bool handshakeEquals(const char* data, const size_t len, const char* text) 
+    {
+      return (strlen(text) == len) && (memcmp(data, text, len) == 0);
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    void HandshakeParser::reset() 
+    {
+      this->_state              = State_StartLine;
+      this->_field              = Field_None;
+      this->_size               = 0;
+      this->_nameLength         = 0;
+      this->_valueLength        = 0;
+      this->_keyLength          = 0;
+      this->_extensionsLength   = 0;
+      this->_key[0]             = '\0';
+      this->_extensions[0]      = '\0';
+      this->_status101          = false;
+      this->_connectionUpgrade  = false;
+      this->_upgradeWebsocket   = false;
+      this->_version13          = false;
+      this->_keyTooLong         = false;
+      this->_extensionsTooLong  = false;
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    HandshakeParser::Result HandshakeParser::feed(const char* data, const size_t len, size_t& consumed) 
+    {
+      consumed = 0;
+      
+      while (consumed < len && this->_state != State_Done) 
+      {
+        // Rejected rather than cut, a truncated offer could be misread
+        if (this->_size >= _WS_HANDSHAKE_MAX_SIZE || this->_extensionsTooLong)
+        {
+          return Result_Error;
+        }
+        
+        const char c = data[consumed++];
+        this->_size++;
+        
+        switch (this->_state) 
+        {
+          case State_StartLine:
+            if (c == '\n')
+            {
+              if (this->_isResponse)
+              {
+                this->_status101 = (this->_valueLength >= 12) && (memcmp(this->_value, "HTTP/1.1 101", 12) == 0);
+              }
+              
+              this->_valueLength  = 0;
+              this->_state        = State_LineStart;
+            }
+            else if (this->_valueLength < sizeof(this->_value))
+            {
+              // Only a response's status line is looked at
+              this->_value[this->_valueLength++] = c;
+            }
+            
+            break;
+            
+          case State_LineStart:
+            if (c == '\r')
+              break;
+              
+            if (c == '\n') 
+            {
+              // Empty line, end of the headers
+              this->_state = State_Done;
+              break;
+            }
+            
+            this->_nameLength = 0;
+            this->_state      = State_Name;
+            // fall through
+            
+          case State_Name:
+            if (c == ':') 
+            {
+              endName();
+              this->_state = State_ValueStart;
+            } 
+            else if (c == '\n') 
+            {
+              // Not a header line, ignored
+              this->_state = State_LineStart;
+            } 
+            else if (this->_nameLength < sizeof(this->_name)) 
+            {
+              // A name cut here is longer than any we look for, so it can't match
+              this->_name[this->_nameLength++] = handshakeLower(c);
+            }
+            
+            break;
+            
+          case State_ValueStart:
+            if (c == ' ' || c == '\t')
+              break;
+            
+            this->_state = State_Value;
+            // fall through
+            
+          case State_Value:
+            if (c == '\n') 
+            {
+              endValue();
+              this->_state = State_LineStart;
+            } 
+            else if (c != '\r') 
+            {
+              valueChar(c);
+            }
+            
+            break;
+            
+          case State_Done:
+            break;
+        }
+      }
+      
+      if (this->_extensionsTooLong)
+        return Result_Error;
+      
+      return (this->_state == State_Done) ? Result_Complete : Result_NeedMore;
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    void HandshakeParser::endName() 
+    {
+      const char*   name    = this->_name;
+      const size_t  length  = this->_nameLength;
+      
+      this->_field        = Field_None;
+      this->_valueLength  = 0;
+      
+      if (handshakeEquals(name, length, HEADER_CONNECTION_LOWER_CASE))
+      {
+        this->_field = Field_Connection;
+      }
+      else if (handshakeEquals(name, length, HEADER_UPGRADE_LOWER_CASE))
+      {
+        this->_field = Field_Upgrade;
+      }
+      else if (handshakeEquals(name, length, WS_VERSION_LOWER_CASE))
+      {
+        this->_field = Field_Version;
+      }
+      else if (handshakeEquals(name, length, this->_isResponse ? WS_ACCEPT_LOWER_CASE : WS_KEY_LOWER_CASE)) 
+      {
+        // The last one wins
+        this->_field      = Field_Key;
+        this->_keyLength  = 0;
+        this->_keyTooLong = false;
+      } 
+      else if (handshakeEquals(name, length, WS_EXTENSIONS_LOWER_CASE)) 
+      {
+        this->_field = Field_Extensions;
+        
+        if (this->_extensionsLength > 0) 
+        {
+          if (this->_extensionsLength + 2 < sizeof(this->_extensions)) 
+          {
+            this->_extensions[this->_extensionsLength++] = ',';
+            this->_extensions[this->_extensionsLength++] = ' ';
+          }
+          else 
+          {
+            this->_extensionsTooLong = true;
+          }
+        }
+      }
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    void HandshakeParser::valueChar(const char c) 
+    {
+      switch (this->_field) 
+      {
+        case Field_None:
+          break;
+          
+        case Field_Key:
+          // Case sensitive
+          if (this->_keyLength < sizeof(this->_key) - 1)
+          {
+            this->_key[this->_keyLength++] = c;
+          }
+          else
+          {
+            this->_keyTooLong = true;
+          }
+          
+          break;
+          
+        case Field_Extensions:
+          if (this->_extensionsLength < sizeof(this->_extensions) - 1)
+          {
+            this->_extensions[this->_extensionsLength++] = handshakeLower(c);
+          }
+          else
+          {
+            this->_extensionsTooLong = true;
+          }
+          
+          break;
+          
+        default:
+          if (this->_valueLength < sizeof(this->_value))
+          {
+            this->_value[this->_valueLength++] = handshakeLower(c);
+          }
+          
+          break;
+      }
+    }
+    
+    /////////////////////////////////////////////////////////
+    
+    void HandshakeParser::endValue() 
+    {
+      const char* value   = this->_value;
+      size_t      length  = this->_valueLength;
+      
+      while (length > 0 && (value[length - 1] == ' ' || value[length - 1] == '\t'))
+        length--;
+      
+      switch (this->_field) 
+      {
+        case Field_Connection:
+        {
+          // Comma separated tokens, e.g. "keep-alive, Upgrade"
+          size_t start = 0;
+          
+          while (start < length) 
+          {
+            size_t end = start;
+            
+            while (end < length && value[end] != ',')
+              end++;
+              
+            size_t tokenStart = start;
+            size_t tokenEnd   = end;
+            
+            while (tokenStart < tokenEnd && (value[tokenStart] == ' ' || value[tokenStart] == '\t'))
+              tokenStart++;
+              
+            while (tokenEnd > tokenStart && (value[tokenEnd - 1] == ' ' || value[tokenEnd - 1] == '\t'))
+              tokenEnd--;
+            
+            if (handshakeEquals(value + tokenStart, tokenEnd - tokenStart, HEADER_UPGRADE_LOWER_CASE))
+            {
+              this->_connectionUpgrade = true;
+            }
+            
+            start = end + 1;
+          }
+          
+          break;
+        }
+          
+        case Field_Upgrade:
+          this->_upgradeWebsocket = handshakeEquals(value, length, HEADER_WEBSOCKET_LOWER_CASE);
+          break;
+          
+        case Field_Version:
+          this->_version13 = handshakeEquals(value, length, "13");
+          break;
+          
+        case Field_Key:
+          while (this->_keyLength > 0 && (this->_key[this->_keyLength - 1] == ' ' || this->_key[this->_keyLength - 1] == '\t'))
+            this->_keyLength--;
+          
+          if (this->_keyTooLong)
+          {
+            this->_keyLength = 0;
+          }
+          
+          this->_key[this->_keyLength] = '\0';
+          break;
+          
+        case Field_Extensions:
+          while (this->_extensionsLength > 0 && 
+                 (this->_extensions[this->_extensionsLength - 1] == ' ' || this->_extensions[this->_extensionsLength - 1] == '\t'))
+          {
+            this->_extensionsLength--;
+          }
+          
+          this->_extensions[this->_extensionsLength] = '\0';
+          break;
+          
+        case Field_None:
+          break;
+      }
+      
+      this->_field = Field_None;
+    }
+  }   // namespace internals2_generic
+}     // namespace websockets2_generic
+
+#endif    // _WEBSOCKETS2_GENERIC_HANDSHAKE_H
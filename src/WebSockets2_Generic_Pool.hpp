@@ -0,0 +1,308 @@
+/****************************************************************************************************************************
+  WebSockets2_Generic_Pool.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy, RP2040 boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.10.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  ...
+  1.9.0   K Hoang      30/11/2021 Auto detect ESP32 core version. Fix bug in examples
+  1.9.1   K Hoang      17/12/2021 Fix QNEthernet TCP interface
+  1.10.0  K Hoang      18/12/2021 Supporting case-insensitive headers, according to RFC2616
+  1.10.1  K Hoang      26/02/2022 Reduce QNEthernet latency
+ *****************************************************************************************************************************/
+
+#ifndef _WEBSOCKETS2_GENERIC_POOL_H
+#define _WEBSOCKETS2_GENERIC_POOL_H
+
+#pragma once
+
+// KH
+#include <WebSockets2_Generic.h>
+
+#ifdef _WS_CONFIG_PAYLOAD_POOL
+
+#include <Tiny_Websockets_Generic/internals/ws_pool.hpp>
+#include <stdlib.h>
+#include <new>
+
+namespace websockets2_generic
+{
+  namespace internals2_generic
+  {
+    BufferPool& bufferPool() 
+    {
+      static BufferPool pool;
+      
+      return pool;
+    }
+    
+    int BufferPool::sizeClass(const size_t size) 
+    {
+      size_t blockSize = _WS_POOL_MIN_BLOCK;
+      
+      for (int sizeClass = 0; sizeClass < _WS_POOL_SIZE_CLASSES; sizeClass++) 
+      {
+        if (size <= blockSize)
+          return sizeClass;
+        
+        blockSize <<= 1;
+      }
+      
+      // Too large to be pooled
+      return -1;
+    }
+    
+    void* BufferPool::heapAllocate(const size_t size) 
+    {
+      void* ptr = this->allocateFunction ? this->allocateFunction(size) : malloc(size);
+      
+      if (ptr == nullptr) 
+      {
+        // Memory kept for other sizes may be just what the heap is missing
+        release();
+        ptr = this->allocateFunction ? this->allocateFunction(size) : malloc(size);
+      }
+      
+      return ptr;
+    }
+    
+    void BufferPool::heapDeallocate(void* ptr, const size_t size) 
+    {
+      if (this->deallocateFunction)
+        this->deallocateFunction(ptr, size);
+      else
+        free(ptr);
+    }
+    
+  #ifdef _WS_CONFIG_STATIC_STRINGS
+    BufferPool::BufferPool() 
+    {
+      uint8_t* block = this->_arena;
+      
+      for (int index = 0; index < _WS_POOL_SIZE_CLASSES; index++) 
+      {
+        const size_t blockSize = static_cast<size_t>(_WS_POOL_MIN_BLOCK) << index;
+        
+        for (int i = 0; i < _WS_POOL_STATIC_BLOCKS; i++) 
+        {
+          FreeBlock* freeBlock  = reinterpret_cast<FreeBlock*>(block);
+          freeBlock->next       = this->_free[index];
+          this->_free[index]    = freeBlock;
+          this->_count[index]++;
+          
+          block += blockSize;
+        }
+      }
+    }
+    
+    int BufferPool::arenaClass(const void* ptr) const 
+    {
+      const uint8_t* block = static_cast<const uint8_t*>(ptr);
+      
+      if (block < this->_arena || block >= this->_arena + ArenaSize)
+        return -1;
+      
+      size_t offset = block - this->_arena;
+      
+      for (int index = 0; index < _WS_POOL_SIZE_CLASSES; index++) 
+      {
+        const size_t regionSize = (static_cast<size_t>(_WS_POOL_MIN_BLOCK) << index) * _WS_POOL_STATIC_BLOCKS;
+        
+        if (offset < regionSize)
+          return index;
+        
+        offset -= regionSize;
+      }
+      
+      return -1;
+    }
+    
+    void* BufferPool::allocate(const size_t size) 
+    {
+      // A larger block rather than the heap
+      for (int index = sizeClass(size); index >= 0 && index < _WS_POOL_SIZE_CLASSES; index++) 
+      {
+        if (this->_free[index] != nullptr) 
+        {
+          FreeBlock* block    = this->_free[index];
+          this->_free[index]  = block->next;
+          this->_count[index]--;
+          
+          return block;
+        }
+      }
+      
+      this->_arenaMisses++;
+      
+      if (this->allocateFunction) 
+      {
+        LOGWARN1("BufferPool::allocate: static blocks exhausted, from allocator size =", size);
+        
+        return this->allocateFunction(size);
+      }
+      
+      LOGERROR1("BufferPool::allocate: static blocks exhausted, failed size =", size);
+      
+    #if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+      throw std::bad_alloc();
+    #else
+      // As operator new does on the cores built without exceptions
+      return nullptr;
+    #endif
+    }
+    
+    void BufferPool::deallocate(void* ptr, const size_t size) 
+    {
+      if (ptr == nullptr)
+        return;
+      
+      const int index = arenaClass(ptr);
+      
+      if (index < 0) 
+      {
+        heapDeallocate(ptr, size);
+        return;
+      }
+      
+      FreeBlock* block    = static_cast<FreeBlock*>(ptr);
+      block->next         = this->_free[index];
+      this->_free[index]  = block;
+      this->_count[index]++;
+    }
+    
+    void BufferPool::release() 
+    {
+      // The static blocks never leave the pool
+    }
+  #else
+    void* BufferPool::allocate(const size_t size) 
+    {
+      const int index = sizeClass(size);
+      
+      if (index < 0) 
+      {
+        return heapAllocate(size);
+      }
+      
+      if (this->_free[index] != nullptr) 
+      {
+        FreeBlock* block    = this->_free[index];
+        this->_free[index]  = block->next;
+        this->_count[index]--;
+        
+        return block;
+      }
+      
+      // Always the full class size, so the block can serve any request of its class later
+      return heapAllocate(static_cast<size_t>(_WS_POOL_MIN_BLOCK) << index);
+    }
+    
+    void BufferPool::deallocate(void* ptr, const size_t size) 
+    {
+      if (ptr == nullptr)
+        return;
+      
+      const int index = sizeClass(size);
+      
+      if (index < 0) 
+      {
+        heapDeallocate(ptr, size);
+      }
+      else if (this->_count[index] < _WS_POOL_FREE_BLOCKS) 
+      {
+        FreeBlock* block    = static_cast<FreeBlock*>(ptr);
+        block->next         = this->_free[index];
+        this->_free[index]  = block;
+        this->_count[index]++;
+      } 
+      else 
+      {
+        heapDeallocate(ptr, static_cast<size_t>(_WS_POOL_MIN_BLOCK) << index);
+      }
+    }
+    
+    void BufferPool::release() 
+    {
+      for (int index = 0; index < _WS_POOL_SIZE_CLASSES; index++) 
+      {
+        while (this->_free[index] != nullptr) 
+        {
+          FreeBlock* block    = this->_free[index];
+          this->_free[index]  = block->next;
+          
+          heapDeallocate(block, static_cast<size_t>(_WS_POOL_MIN_BLOCK) << index);
+        }
+        
+        this->_count[index] = 0;
+      }
+    }
+  #endif
+    
+    size_t BufferPool::cachedBlocks() const 
+    {
+      size_t blocks = 0;
+      
+      for (int index = 0; index < _WS_POOL_SIZE_CLASSES; index++)
+        blocks += this->_count[index];
+      
+      return blocks;
+    }
+    
+    size_t BufferPool::cachedBytes() const 
+    {
+      size_t bytes = 0;
+      
+      for (int index = 0; index < _WS_POOL_SIZE_CLASSES; index++)
+        bytes += (static_cast<size_t>(_WS_POOL_MIN_BLOCK) << index) * this->_count[index];
+      
+      return bytes;
+    }
+  }   // namespace internals2_generic
+  
+  void setPoolAllocator(AllocateFunction allocate, DeallocateFunction deallocate) 
+  {
+    auto& pool = internals2_generic::bufferPool();
+    
+    // Kept blocks belong to the previous functions
+    pool.release();
+    
+    pool.allocateFunction   = allocate;
+    pool.deallocateFunction = deallocate;
+  }
+  
+  size_t poolCachedBlocks() 
+  {
+    return internals2_generic::bufferPool().cachedBlocks();
+  }
+  
+  size_t poolCachedBytes() 
+  {
+    return internals2_generic::bufferPool().cachedBytes();
+  }
+  
+  void poolRelease() 
+  {
+    internals2_generic::bufferPool().release();
+  }
+  
+#ifdef _WS_CONFIG_STATIC_STRINGS
+  size_t poolArenaMisses() 
+  {
+    return internals2_generic::bufferPool().arenaMisses();
+  }
+#endif
+}     // namespace websockets2_generic
+
+#endif    // _WS_CONFIG_PAYLOAD_POOL
+
+#endif    // _WEBSOCKETS2_GENERIC_POOL_H
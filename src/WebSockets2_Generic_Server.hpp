@@ -33,7 +33,6 @@
 #include <Tiny_Websockets_Generic/server.hpp>
 #include <Tiny_Websockets_Generic/internals/wscrypto/crypto.hpp>
 #include <memory>
-#include <map>
 
 // Important for Teensy, or compile error
 #include <algorithm>
@@ -58,87 +57,259 @@ namespace websockets2_generic
   
   bool WebsocketsServer::poll() 
   {
-    return this->_server->poll();
+    if (!this->_ownsConnections)
+    {
+      return this->_server->poll();
+    }
+    
+    bool accepted = acceptConnection();
+    
+    return serviceConnections() || accepted;
   }
   
   /////////////////////////////////////////////////////////
   
-  struct ParsedHandshakeParams 
+  void WebsocketsServer::onConnection(const ConnectionCallback callback) 
   {
-    WSString head;
+    this->_connectionCallback = callback;
+    this->_ownsConnections = true;
     
-    // To store original headers
-    std::map<WSString, WSString> headers;
+    setMaxConnections(this->_maxConnections);
+  }
+  
+  /////////////////////////////////////////////////////////
+  
+  void WebsocketsServer::onMessage(const MessageCallback callback) 
+  {
+    this->_messagesCallback = callback;
+    this->_ownsConnections = true;
     
-    // To store lowercased headers
-    std::map<WSString, WSString> lowheaders;
-  };
+    setMaxConnections(this->_maxConnections);
+  }
   
   /////////////////////////////////////////////////////////
   
-  ParsedHandshakeParams recvHandshakeRequest(network2_generic::TcpClient& client) 
+  void WebsocketsServer::onEvent(const EventCallback callback) 
   {
-    ParsedHandshakeParams result;
+    this->_eventsCallback = callback;
+    this->_ownsConnections = true;
+    
+    setMaxConnections(this->_maxConnections);
+  }
   
-    result.head = client.readLine();
+  /////////////////////////////////////////////////////////
   
-    WSString line = client.readLine();
+  void WebsocketsServer::setMaxConnections(const size_t maxConnections) 
+  {
+    this->_maxConnections = maxConnections;
     
-    do 
+    // Sized once, so a burst of connections doesn't regrow (and fragment) the heap
+    this->_handshakes.reserve(maxConnections);
+    this->_connections.reserve(maxConnections);
+  }
+  
+  /////////////////////////////////////////////////////////
+  
+  size_t WebsocketsServer::getConnectionsCount() const 
+  {
+    return this->_connections.size();
+  }
+  
+  /////////////////////////////////////////////////////////
+  
+  void WebsocketsServer::addResponseHeader(const WSInterfaceString& name, const WSInterfaceString& value) 
+  {
+    this->_responseHeaders += internals2_generic::fromInterfaceString(name) + ": " + 
+                              internals2_generic::fromInterfaceString(value) + HEADER_HOST_RN;
+  }
+  
+  /////////////////////////////////////////////////////////
+  
+  void WebsocketsServer::broadcast(const WSInterfaceString& data) 
+  {
+    broadcast(data.c_str(), data.length());
+  }
+  
+  /////////////////////////////////////////////////////////
+  
+  void WebsocketsServer::broadcast(const char* data, const size_t len) 
+  {
+    for (auto& client : this->_connections) 
     {
-      WSString key = "", value = "";
-      
-      size_t idx = 0;
+      client->send(data, len);
+    }
+  }
+  
+  /////////////////////////////////////////////////////////
+  
+  void WebsocketsServer::broadcastBinary(const char* data, const size_t len) 
+  {
+    for (auto& client : this->_connections) 
+    {
+      client->sendBinary(data, len);
+    }
+  }
+  
+  /////////////////////////////////////////////////////////
   
-      // read key
-      while (idx < line.size() && line[idx] != ':') 
+  // At most one new client per poll(), a burst of connections must not starve the live ones.
+  // Handshakes then advance with whatever bytes have arrived, never waiting for more
+  bool WebsocketsServer::acceptConnection() 
+  {
+    if ( (this->_connections.size() + this->_handshakes.size() < this->_maxConnections) && this->_server->poll() )
+    {
+      std::shared_ptr<network2_generic::TcpClient> tcpClient(this->_server->accept());
+      
+      if (tcpClient && tcpClient->available())
+      {
+        this->_handshakes.push_back({ tcpClient, internals2_generic::HandshakeRequestParser(), millis() });
+      }
+    }
+    // Over the limit, new clients wait in the listen backlog
+    
+    bool accepted = false;
+    size_t kept   = 0;
+    
+    for (size_t i = 0; i < this->_handshakes.size(); i++) 
+    {
+      auto status = advanceHandshake(this->_handshakes[i]);
+      
+      if (status == HandshakeStatus_Pending)
+      {
+        if (kept != i)
+        {
+          this->_handshakes[kept] = std::move(this->_handshakes[i]);
+        }
+        
+        kept++;
+        continue;
+      }
+      
+      if (status == HandshakeStatus_Failed)
+      {
+        this->_handshakes[i].client->close();
+        continue;
+      }
+      
+      if (status == HandshakeStatus_Rejected)
+      {
+        reject(this->_handshakes[i].client);
+        continue;
+      }
+      
+      // Closed already if it failed
+      auto client = upgrade(this->_handshakes[i].client, this->_handshakes[i].request);
+      
+      if (!client)
+      {
+        continue;
+      }
+      
+      if (this->_messagesCallback)
+      {
+        client->onMessage(this->_messagesCallback);
+      }
+      
+      if (this->_eventsCallback)
+      {
+        client->onEvent(this->_eventsCallback);
+      }
+      
+      this->_connections.push_back(client);
+      accepted = true;
+      
+      LOGINFO1("WebsocketsServer::acceptConnection: connections =", this->_connections.size());
+      
+      if (this->_connectionCallback)
       {
-        key += line[idx];
-        idx++;
+        this->_connectionCallback(*client);
       }
+    }
+    
+    this->_handshakes.resize(kept);
+    
+    return accepted;
+  }
   
-      // skip key and whitespace
-      idx++;
-      while (idx < line.size() && (line[idx] == ' ' || line[idx] == '\t')) 
-        idx++;
+  /////////////////////////////////////////////////////////
   
-      // read value (until \r\n)
-      while (idx < line.size() && line[idx] != '\r') 
+  bool WebsocketsServer::serviceConnections() 
+  {
+    bool messageReceived = false;
+    size_t count = this->_connections.size();
+    
+    // Round robin, starting one further each time, with a per connection budget
+    for (size_t i = 0; i < count; i++) 
+    {
+      // Keep a reference, callbacks may close the connection
+      auto client = this->_connections[(this->_nextConnection + i) % count];
+      
+      if (client->_poll(_WS_SERVER_MESSAGES_PER_POLL))
       {
-        value += line[idx];
-        idx++;
+        messageReceived = true;
       }
+    }
+    
+    this->_nextConnection = (count > 0) ? (this->_nextConnection + 1) % count : 0;
+    
+    // available() fires ConnectionClosed on the way out
+    this->_connections.erase(std::remove_if(this->_connections.begin(), this->_connections.end(), 
+                             [](const std::shared_ptr<WebsocketsClient>& client) 
+    {
+      return !client->available();
+    }), this->_connections.end());
+    
+    return messageReceived;
+  }
+  
+  /////////////////////////////////////////////////////////
+  
+  // Takes whatever part of the request has arrived. Only the parser's fixed state and a start time
+  // are kept between calls
+  WebsocketsServer::HandshakeStatus WebsocketsServer::advanceHandshake(PendingHandshake& handshake) 
+  {
+    if (!handshake.client->available())
+    {
+      return HandshakeStatus_Failed;
+    }
+    
+    while (handshake.client->poll()) 
+    {
+      uint8_t buffer[_WS_BUFFER_SIZE];
       
-      // KH
-      LOGINFO1("WebsocketsServer::recvHandshakeRequest: key =", internals2_generic::fromInternalString(key));
-      LOGINFO1("WebsocketsServer::recvHandshakeRequest: value =", internals2_generic::fromInternalString(value));
-      //////
+      auto numRead = handshake.client->read(buffer, sizeof(buffer));
+      
+      if (numRead == static_cast<uint32_t>(-1) || numRead == 0)
+        break;
       
-      // store headers before tolower(), so we can search both
-      result.headers[key] = value;
-     
-      // convert to lower case
-      std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+      size_t consumed;
+      auto result = handshake.request.feed(reinterpret_cast<const char*>(buffer), numRead, consumed);
       
-      // Important, don't change these case-sensitive data : `Sec-WebSocket-Key` and `Origin`
-      if ( (key != WS_KEY_LOWER_CASE) && (key != HEADER_ORIGIN_LOWER_CASE) )
-      {    
-        std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+      if (result == internals2_generic::HandshakeRequestParser::Result_Error)
+      {
+        LOGERROR("WebsocketsServer::advanceHandshake: request or its extensions too long");
+        return HandshakeStatus_Rejected;
       }
-      //////
-  
-      // store header after tolower()
-      result.lowheaders[key] = value;
       
-      // KH
-      LOGDEBUG1("WebsocketsServer::recvHandshakeRequest: lowkey =", internals2_generic::fromInternalString(key));
-      LOGDEBUG1("WebsocketsServer::recvHandshakeRequest: lowvalue =", internals2_generic::fromInternalString(value));
-      //////
+      if (result == internals2_generic::HandshakeRequestParser::Result_Complete)
+      {
+        if (consumed < numRead)
+        {
+          // The client must wait for our response before sending frames (RFC 6455, 4.1)
+          LOGWARN1("WebsocketsServer::advanceHandshake: dropped bytes after request =", numRead - consumed);
+        }
         
-      line = client.readLine();
-    } while (client.available() && line != HEADER_HOST_RN);    
-      
-    return result;
+        return HandshakeStatus_Complete;
+      }
+    }
+    
+    if (millis() - handshake.startedAt > _WS_HANDSHAKE_TIMEOUT)
+    {
+      LOGERROR("WebsocketsServer::advanceHandshake: timeout");
+      return HandshakeStatus_Failed;
+    }
+    
+    return HandshakeStatus_Pending;
   }
   
   /////////////////////////////////////////////////////////
@@ -161,60 +332,151 @@ namespace websockets2_generic
       //////
       return {};
     }
-  
-    auto params = recvHandshakeRequest(*tcpClient);
-  
-    if ( (params.headers[HEADER_CONNECTION_NORMAL].find(HEADER_UPGRADE_NORMAL) == std::string::npos) && 
-         (params.lowheaders[HEADER_CONNECTION_LOWER_CASE].find(HEADER_UPGRADE_LOWER_CASE) == std::string::npos) )     
+    
+    // accept() has to return the upgraded client, so it waits here, but no longer than _WS_HANDSHAKE_TIMEOUT
+    // in total. poll() with onConnection() does the same without waiting
+    PendingHandshake handshake = { tcpClient, internals2_generic::HandshakeRequestParser(), millis() };
+    HandshakeStatus  status;
+    
+    while ( (status = advanceHandshake(handshake)) == HandshakeStatus_Pending )
     {
-      // KH
-      LOGERROR("WebsocketsServer::accept: Connection != Upgrade");
-      //////
+      yield();
+    }
+    
+    if (status == HandshakeStatus_Failed)
+    {
+      tcpClient->close();
       return {};
     }
-      
-    if ( (params.headers[HEADER_UPGRADE_NORMAL] != HEADER_WEBSOCKET_LOWER_CASE) && 
-         (params.lowheaders[HEADER_UPGRADE_LOWER_CASE] != HEADER_WEBSOCKET_LOWER_CASE) )
+    
+    if (status == HandshakeStatus_Rejected)
     {
-      // KH
-      LOGERROR("WebsocketsServer::accept: Upgrade != websocket");
-      //////
+      reject(tcpClient);
       return {};
     }
-      
-    if ( (params.headers[WS_VERSION_NORMAL] != "13") && (params.lowheaders[WS_VERSION_LOWER_CASE] != "13") )
-    { 
-      // KH
-      LOGERROR("WebsocketsServer::accept: Version != 13");
-      //////
+    
+    auto client = upgrade(tcpClient, handshake.request);
+    
+    if (!client)
+    {
       return {};
     }
-      
-    if ( (params.headers[WS_KEY_NORMAL] == "") && (params.lowheaders[WS_KEY_LOWER_CASE] == "") )
+    
+    return *client;
+  }
+  
+  /////////////////////////////////////////////////////////
+  
+  // Answers the request with 101 Switching Protocols, or with 400 Bad Request if it isn't a valid upgrade.
+  // Returns nullptr, without creating a client, when the connection was refused or lost
+  std::shared_ptr<WebsocketsClient> WebsocketsServer::upgrade(std::shared_ptr<network2_generic::TcpClient> tcpClient, 
+                                                              const internals2_generic::HandshakeRequestParser& request) 
+  {
+    const char* error = nullptr;
+    
+    if (!request.isConnectionUpgrade())
+    {
+      error = "Connection != Upgrade";
+    }
+    else if (!request.isUpgradeWebsocket())
+    {
+      error = "Upgrade != websocket";
+    }
+    else if (!request.isVersion13())
+    { 
+      error = "Version != 13";
+    }
+    else if (request.key()[0] == '\0')
+    {
+      error = "Key == NULL";
+    }
+    
+    if (error)
     {
       // KH
-      LOGERROR("WebsocketsServer::accept: Key == NULL");
+      LOGERROR1("WebsocketsServer::accept:", error);
       //////
-      return {};
+      reject(tcpClient);
+      
+      return nullptr;
     }
   
-    auto serverAccept = crypto2_generic::websocketsHandshakeEncodeKey(params.lowheaders[WS_KEY_LOWER_CASE]);
-  
-    tcpClient->send("HTTP/1.1 101 Switching Protocols\r\n");
-    tcpClient->send(HEADER_CONNECTION_UPGRADE_NORMAL);
-    tcpClient->send(HEADER_UPGRADE_WS_NORMAL);
-    tcpClient->send(HEADER_WS_VERSION_13_NORMAL);
-    tcpClient->send(HEADER_WS_ACCEPT_NORMAL + serverAccept + HEADER_HOST_RN);
-    tcpClient->send(HEADER_HOST_RN);
+    char serverAccept[30];
+    crypto2_generic::websocketsHandshakeEncodeKey(request.key(), serverAccept);
+    
+    // The whole response in one write: constant parts, computed key, then optional headers
+    static const char responseStart[] = "HTTP/1.1 101 Switching Protocols\r\n"
+                                        HEADER_CONNECTION_UPGRADE_NORMAL
+                                        HEADER_UPGRADE_WS_NORMAL
+                                        HEADER_WS_VERSION_13_NORMAL
+                                        HEADER_WS_ACCEPT_NORMAL;
+    
+    network2_generic::TcpSegment  response[7];
+    size_t                        count = 0;
+    
+    response[count++] = { reinterpret_cast<const uint8_t*>(responseStart), sizeof(responseStart) - 1 };
+    response[count++] = { reinterpret_cast<const uint8_t*>(serverAccept), static_cast<uint32_t>(strlen(serverAccept)) };
+    response[count++] = { reinterpret_cast<const uint8_t*>(HEADER_HOST_RN), 2 };
+    
+  #ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+    internals2_generic::DeflateParams deflateParams;
+    WSString deflateResponse;
+    
+    if (internals2_generic::deflateAcceptOffer(request.extensions(), deflateParams, deflateResponse))
+    {
+      deflateResponse = HEADER_WS_EXTENSIONS_NORMAL + deflateResponse + HEADER_HOST_RN;
+      response[count++] = { reinterpret_cast<const uint8_t*>(deflateResponse.c_str()), static_cast<uint32_t>(deflateResponse.size()) };
+    }
+  #endif
+    
+    if (!this->_responseHeaders.empty())
+    {
+      response[count++] = { reinterpret_cast<const uint8_t*>(this->_responseHeaders.c_str()), static_cast<uint32_t>(this->_responseHeaders.size()) };
+    }
+    
+    response[count++] = { reinterpret_cast<const uint8_t*>(HEADER_HOST_RN), 2 };
+    
+    if (!tcpClient->sendSegments(response, count))
+    {
+      LOGERROR("WebsocketsServer::accept: response not sent");
+      tcpClient->close();
+      
+      return nullptr;
+    }
   
-    WebsocketsClient wsClient(tcpClient);
+    auto wsClient = std::make_shared<WebsocketsClient>(tcpClient);
     // Don't use masking from server to client (according to RFC)
-    wsClient.setUseMasking(false);
+    wsClient->setUseMasking(false);
+    
+  #ifdef _WS_CONFIG_PERMESSAGE_DEFLATE
+    wsClient->_endpoint.setDeflate(deflateParams, true);
+  #endif
+  
     return wsClient;
   }
+  
+  /////////////////////////////////////////////////////////
+  
+  // Tells the client why before closing, instead of leaving it to guess from a dropped connection.
+  // Version 13 is the only one we speak (RFC 6455, 4.4)
+  void WebsocketsServer::reject(std::shared_ptr<network2_generic::TcpClient> tcpClient) 
+  {
+    static const char response[] = "HTTP/1.1 400 Bad Request\r\n"
+                                   "Connection: close\r\n"
+                                   HEADER_WS_VERSION_13_NORMAL
+                                   HEADER_HOST_RN;
+    
+    tcpClient->send(reinterpret_cast<const uint8_t*>(response), sizeof(response) - 1);
+    tcpClient->close();
+  }
    
   WebsocketsServer::~WebsocketsServer() 
   {
+    for (auto& client : this->_connections) 
+    {
+      client->close();
+    }
+    
     this->_server->close();
   }
 